@@ -20,15 +20,22 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 // std
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
 #include <iostream>
+#include <thread>
 
 // occt
 #include "GlfwOcctView.h"
+#include <AIS_ColoredShape.hxx>
 #include <AIS_InteractiveContext.hxx>
 #include <AIS_Shape.hxx>
 #include <Aspect_DisplayConnection.hxx>
 #include <Aspect_Handle.hxx>
+#include <Aspect_Window.hxx>
 #include <BRepPrimAPI_MakeBox.hxx>
 #include <BRepPrimAPI_MakeCone.hxx>
 #include <BRepTools.hxx>
@@ -36,7 +43,10 @@
 #include <BRep_Tool.hxx>
 #include <Message.hxx>
 #include <Message_Messenger.hxx>
+#include <OSD_MemInfo.hxx>
 #include <OpenGl_GraphicDriver.hxx>
+#include <StdSelect_BRepOwner.hxx>
+#include <Standard_Failure.hxx>
 #include <Standard_Type.hxx>
 #include <TopAbs_ShapeEnum.hxx>
 #include <TopExp.hxx>
@@ -52,6 +62,7 @@
 #include <backends/imgui_impl_opengl3.h>
 #include <imgui.h>
 #include <imgui_internal.h>
+#include <misc/cpp/imgui_stdlib.h>
 
 // glfw
 #include <GLFW/glfw3.h>
@@ -61,7 +72,11 @@
 
 // other
 #include "GlfwOcctView.h"
+#include "face_diff.h"
 #include "haunch.h"
+#include "haunch_export.h"
+#include "profiler.h"
+#include "rib_features.h"
 
 #ifdef _WIN32
 #include <WNT_WClass.hxx>
@@ -87,21 +102,33 @@ namespace win_data
     static const std::string gui;
   };
 
-  const std::string DockWinId::content = "Content";
+  const std::string DockWinId::content = "Perspective";
   const std::string DockWinId::gui     = "Gui";
 
-  struct Content
+  struct ViewportPreset
   {
-    static Graphic3d_Vec2i pos;
-    static Graphic3d_Vec2i size;
+    const char* name;
+    V3d_TypeOfOrientation orientation;
   };
 
-  Graphic3d_Vec2i Content::pos  = Graphic3d_Vec2i(0, 0);
-  Graphic3d_Vec2i Content::size = Graphic3d_Vec2i(0, 0);
+  // Fixed orthographic views for rib review, next to the free perspective one
+  static constexpr ViewportPreset VIEWPORT_PRESETS[] = {
+    { "Top", V3d_Zpos },
+    { "Front", V3d_Yneg },
+    { "Right", V3d_Xpos },
+  };
 } // namespace win_data
 
 namespace
 {
+  //! Convert an OCCT color into a packed ImGui color.
+  static ImU32 imColor(const Quantity_Color& theColor)
+  {
+    Standard_Real aRed = 0.0, aGreen = 0.0, aBlue = 0.0;
+    theColor.Values(aRed, aGreen, aBlue, Quantity_TOC_sRGB);
+    return ImGui::ColorConvertFloat4ToU32(ImVec4((float)aRed, (float)aGreen, (float)aBlue, 1.0f));
+  }
+
   //! Convert GLFW mouse button into Aspect_VKeyMouse.
   static Aspect_VKeyMouse mouseButtonFromGlfw(int theButton)
   {
@@ -151,13 +178,26 @@ namespace
     }
   }
 
-  static Graphic3d_Vec2i cursorToLocalViewport(Graphic3d_Vec2i cursor)
+  //! Create a virtual window a view renders into offscreen.
+  static Handle(Aspect_Window) createOffscreenWindow(const Handle(Aspect_DisplayConnection)& theDisp)
   {
-    int x = cursor.x() - win_data::Content::pos.x();
-    x *= win_data::CONTENT_WIDTH / (float)win_data::Content::size.x();
-    int y = cursor.y() - win_data::Content::pos.y();
-    y *= win_data::CONTENT_HEIGHT / (float)win_data::Content::size.y();
-    return Graphic3d_Vec2i(x, y);
+    const TCollection_AsciiString aWinName("OCCT offscreen window");
+    Graphic3d_Vec2i aWinSize(win_data::CONTENT_WIDTH, win_data::CONTENT_HEIGHT);
+#if defined(_WIN32)
+    (void)theDisp;
+    const TCollection_AsciiString aClassName("OffscreenClass");
+    // empty callback!
+    static Handle(WNT_WClass) aWinClass = new WNT_WClass(aClassName.ToCString(), nullptr, 0);
+    Handle(WNT_Window) aWindow = new WNT_Window(
+        aWinName.ToCString(), aWinClass, WS_POPUP, 64, 64, aWinSize.x(), aWinSize.y(), Quantity_NOC_BLACK);
+#elif defined(__APPLE__)
+    (void)theDisp;
+    Handle(Cocoa_Window) aWindow = new Cocoa_Window(aWinName.ToCString(), 64, 64, aWinSize.x(), aWinSize.y());
+#else
+    Handle(Xw_Window) aWindow = new Xw_Window(theDisp, aWinName.ToCString(), 64, 64, aWinSize.x(), aWinSize.y());
+#endif
+    aWindow->SetVirtual(true);
+    return aWindow;
   }
 } // namespace
 
@@ -205,7 +245,7 @@ void GlfwOcctView::run()
   initDemoScene();
   if (myView.IsNull()) { return; }
 
-  myView->MustBeResized();
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports) { aViewport->view->MustBeResized(); }
   myOcctWindow->Map();
   initUI();
   mainloop();
@@ -265,25 +305,25 @@ void GlfwOcctView::initViewer()
   myViewer->SetDefaultTypeOfView(V3d_PERSPECTIVE);
   myViewer->ActivateGrid(Aspect_GT_Rectangular, Aspect_GDM_Lines);
 
-  // create offscreen window
-  const TCollection_AsciiString aWinName("OCCT offscreen window");
-  Graphic3d_Vec2i aWinSize(win_data::CONTENT_WIDTH, win_data::CONTENT_HEIGHT);
-#if defined(_WIN32)
-  const TCollection_AsciiString aClassName("OffscreenClass");
-  // empty callback!
-  Handle(WNT_WClass) aWinClass = new WNT_WClass(aClassName.ToCString(), nullptr, 0);
-  Handle(WNT_Window) aWindow =
-      new WNT_Window(aWinName.ToCString(), aWinClass, WS_POPUP, 64, 64, aWinSize.x(), aWinSize.y(), Quantity_NOC_BLACK);
-#elif defined(__APPLE__)
-  Handle(Cocoa_Window) aWindow = new Cocoa_Window(aWinName.ToCString(), 64, 64, aWinSize.x(), aWinSize.y());
-#else
-  Handle(Xw_Window) aWindow = new Xw_Window(aDisp, aWinName.ToCString(), 64, 64, aWinSize.x(), aWinSize.y());
-#endif
-  aWindow->SetVirtual(true);
-
-  // create 3D view from offscreen window
-  myView = myViewer->CreateView();
-  myView->SetWindow(aWindow);
+  // create a 3D view on an offscreen window of its own for every viewport; the views share the viewer and
+  // its structures, so models are meshed and uploaded once
+  const auto addViewport = [&](const std::string& theName) -> Viewport& {
+    myViewports.push_back(std::make_unique<Viewport>());
+    Viewport& aViewport = *myViewports.back();
+    aViewport.name      = theName;
+    aViewport.view      = myViewer->CreateView();
+    aViewport.view->SetWindow(createOffscreenWindow(aDisp));
+    return aViewport;
+  };
+  addViewport(win_data::DockWinId::content);
+  for (const win_data::ViewportPreset& aPreset : win_data::VIEWPORT_PRESETS)
+  {
+    const Handle(V3d_View)& aView = addViewport(aPreset.name).view;
+    aView->Camera()->SetProjectionType(Graphic3d_Camera::Projection_Orthographic);
+    aView->SetProj(aPreset.orientation);
+  }
+  myActiveViewport = myViewports.front().get();
+  myView           = myActiveViewport->view;
 }
 
 // ================================================================
@@ -294,7 +334,10 @@ void GlfwOcctView::initDemoScene()
 {
   if (myContext.IsNull()) { return; }
 
-  myView->TriedronDisplay(Aspect_TOTP_LEFT_LOWER, Quantity_NOC_GOLD, 0.08, V3d_WIREFRAME);
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+  {
+    aViewport->view->TriedronDisplay(Aspect_TOTP_LEFT_LOWER, Quantity_NOC_GOLD, 0.08, V3d_WIREFRAME);
+  }
 
   TCollection_AsciiString aGlInfo;
   {
@@ -318,37 +361,119 @@ void GlfwOcctView::mainloop()
 {
   while (!glfwWindowShouldClose(myOcctWindow->getGlfwWindow()))
   {
+    // sleep first and sample input afterwards, so the frame reacts to the latest events
+    myPacer.wait();
+    if (myView.IsNull())
+    {
+      glfwPollEvents();
+      continue;
+    }
+
+    pollLoader();
+    pollWatcher();
+    updateMeshLods();
     // glfwPollEvents() for continuous rendering (immediate return if there are no new events)
     // and glfwWaitEvents() for rendering on demand (something actually happened in the viewer)
     glfwPollEvents();
     // glfwWaitEvents();
-    if (!myView.IsNull())
+    const FramePacer::Clock::time_point anInputTime = myInputTime;
+    myInputTime                                     = FramePacer::Clock::time_point();
+
+    // input only moves the camera of the active view, but the hover highlight shows in all of them
+    FlushViewEvents(myContext, myView, true);
+    if (myContext->DetectedOwner() != myDetected)
     {
-      // render view offscreen
-      FlushViewEvents(myContext, myView, true);
-      if (!myView->ToPixMap(myTexture.pixMap, win_data::CONTENT_WIDTH, win_data::CONTENT_HEIGHT))
-      {
-        std::cerr << "View dump failed\n";
-      }
-      //
+      myDetected = myContext->DetectedOwner();
+      invalidateViewports();
+    }
+    const FramePacer::Clock::time_point aShownInputTime = renderViewports(anInputTime);
 
-      // render scene
-      glfwMakeContextCurrent(myOcctWindow->getGlfwWindow());
-      pixMapToGL(myTexture.pixMap, myTexture.glID);
-      render();
-      glfwSwapBuffers(myOcctWindow->getGlfwWindow());
+    // render scene
+    render();
+    glfwSwapBuffers(myOcctWindow->getGlfwWindow());
+    myPacer.presented();
+    if (aShownInputTime != FramePacer::Clock::time_point())
+    {
+      Profiler::instance().record(
+          "input to photon",
+          std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - aShownInputTime).count());
     }
   }
 }
 
+// ================================================================
+// Function : renderViewports
+// Purpose  :
+// ================================================================
+FramePacer::Clock::time_point GlfwOcctView::renderViewports(FramePacer::Clock::time_point theInputTime)
+{
+  // views are rendered offscreen, and only when their camera or the scene changed since their last frame
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+  {
+    if (!aViewport->visible)
+    {
+      aViewport->revision = 0;
+      continue;
+    }
+    if (aViewport->revision == mySceneRevision && aViewport->camera == aViewport->view->Camera()->WorldViewProjState())
+    {
+      continue;
+    }
+
+    const bool isActive = aViewport.get() == myActiveViewport;
+    if (!aViewport->readback.render(aViewport->view,
+                                    win_data::CONTENT_WIDTH,
+                                    win_data::CONTENT_HEIGHT,
+                                    isActive ? theInputTime : FramePacer::Clock::time_point()))
+    {
+      std::cerr << "View dump failed: " << aViewport->name << "\n";
+    }
+    // taken after rendering, which may still fit the depth range of the camera
+    aViewport->camera   = aViewport->view->Camera()->WorldViewProjState();
+    aViewport->revision = mySceneRevision;
+  }
+
+  // the pixels shown are those of the previous frame of a view, whose copy has finished by now
+  FramePacer::Clock::time_point aShownInputTime;
+  std::vector<Viewport*> aFetched;
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+  {
+    FramePacer::Clock::time_point aStamp;
+    if (!aViewport->readback.fetch(aViewport->view, aViewport->pixMap, aStamp)) { continue; }
+    aFetched.push_back(aViewport.get());
+    if (aViewport.get() == myActiveViewport) { aShownInputTime = aStamp; }
+  }
+
+  glfwMakeContextCurrent(myOcctWindow->getGlfwWindow());
+  for (Viewport* aViewport : aFetched) { pixMapToGL(aViewport->pixMap, aViewport->glID); }
+  return aShownInputTime;
+}
+
+// ================================================================
+// Function : noteInput
+// Purpose  :
+// ================================================================
+void GlfwOcctView::noteInput()
+{
+  // the oldest event not yet rendered is the one the latency is measured from
+  if (myInputTime == FramePacer::Clock::time_point()) { myInputTime = FramePacer::Clock::now(); }
+}
+
 // ================================================================
 // Function : cleanup
 // Purpose  :
 // ================================================================
 void GlfwOcctView::cleanup()
 {
-  glDeleteTextures(1, &myTexture.glID);
-  if (!myView.IsNull()) { myView->Remove(); }
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+  {
+    glDeleteTextures(1, &aViewport->glID);
+    aViewport->readback.release(aViewport->view);
+    aViewport->view->Remove();
+  }
+  myViewports.clear();
+  myActiveViewport = nullptr;
+  myView.Nullify();
   if (!myOcctWindow.IsNull()) { myOcctWindow->Close(); }
   glfwTerminate();
 }
@@ -359,12 +484,14 @@ void GlfwOcctView::cleanup()
 // ================================================================
 void GlfwOcctView::onResize(int theWidth, int theHeight)
 {
-  if (theWidth != 0 && theHeight != 0 && !myView.IsNull())
+  if (theWidth == 0 || theHeight == 0) { return; }
+
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
   {
-    myView->Window()->DoResize();
-    myView->MustBeResized();
-    myView->Invalidate();
-    myView->Redraw();
+    aViewport->view->Window()->DoResize();
+    aViewport->view->MustBeResized();
+    aViewport->view->Invalidate();
+    aViewport->view->Redraw();
   }
 }
 
@@ -374,7 +501,12 @@ void GlfwOcctView::onResize(int theWidth, int theHeight)
 // ================================================================
 void GlfwOcctView::onMouseScroll(double theOffsetX, double theOffsetY)
 {
-  if (!myView.IsNull()) { UpdateZoom(Aspect_ScrollDelta(myOcctWindow->CursorPosition(), int(theOffsetY * 8.0))); }
+  noteInput();
+  if (myView.IsNull()) { return; }
+
+  const Graphic3d_Vec2i aCursor = myOcctWindow->CursorPosition();
+  activateViewportAt(aCursor);
+  UpdateZoom(Aspect_ScrollDelta(toActiveViewport(aCursor), int(theOffsetY * 8.0)));
 }
 
 // ================================================================
@@ -385,12 +517,29 @@ void GlfwOcctView::onMouseButton(int theButton, int theAction, int theMods)
 {
   if (myView.IsNull()) { return; }
 
-  const Graphic3d_Vec2i aPos = cursorToLocalViewport(myOcctWindow->CursorPosition());
+  noteInput();
+  const Graphic3d_Vec2i aCursor = myOcctWindow->CursorPosition();
   if (theAction == GLFW_PRESS)
   {
-    PressMouseButton(aPos, mouseButtonFromGlfw(theButton), keyFlagsFromGlfw(theMods), false);
+    activateViewportAt(aCursor);
+    if (theButton == GLFW_MOUSE_BUTTON_LEFT) { myLeftPressPos = aCursor; }
+    PressMouseButton(toActiveViewport(aCursor), mouseButtonFromGlfw(theButton), keyFlagsFromGlfw(theMods), false);
+  }
+  else
+  {
+    // A left click without drag is a pick and an Alt+left drag a box selection; orbiting, panning and zooming
+    // need no selection. The controller picks when it handles the release, so deferred selection prepared
+    // here is already active for the first pick.
+    const Graphic3d_Vec2i aDrag = aCursor - myLeftPressPos;
+    const bool isClick          = double(aDrag.x()) * aDrag.x() + double(aDrag.y()) * aDrag.y()
+                         <= myMouseClickThreshold * myMouseClickThreshold;
+    if (theButton == GLFW_MOUSE_BUTTON_LEFT && viewportAt(aCursor) != nullptr
+        && (isClick || (theMods & GLFW_MOD_ALT) != 0))
+    {
+      activatePendingSelection();
+    }
+    ReleaseMouseButton(toActiveViewport(aCursor), mouseButtonFromGlfw(theButton), keyFlagsFromGlfw(theMods), false);
   }
-  else { ReleaseMouseButton(aPos, mouseButtonFromGlfw(theButton), keyFlagsFromGlfw(theMods), false); }
 }
 
 // ================================================================
@@ -399,8 +548,66 @@ void GlfwOcctView::onMouseButton(int theButton, int theAction, int theMods)
 // ================================================================
 void GlfwOcctView::onMouseMove(int thePosX, int thePosY)
 {
-  const Graphic3d_Vec2i aNewPos = cursorToLocalViewport(Graphic3d_Vec2i(thePosX, thePosY));
-  if (!myView.IsNull()) { UpdateMousePosition(aNewPos, PressedMouseButtons(), LastMouseFlags(), false); }
+  noteInput();
+  if (myView.IsNull()) { return; }
+
+  const Graphic3d_Vec2i aCursor(thePosX, thePosY);
+  activateViewportAt(aCursor);
+  UpdateMousePosition(toActiveViewport(aCursor), PressedMouseButtons(), LastMouseFlags(), false);
+}
+
+// ================================================================
+// Function : OnSelectionChanged
+// Purpose  :
+// ================================================================
+void GlfwOcctView::OnSelectionChanged(const Handle(AIS_InteractiveContext)&, const Handle(V3d_View)&)
+{
+  invalidateViewports();
+}
+
+// ================================================================
+// Function : viewportAt
+// Purpose  :
+// ================================================================
+GlfwOcctView::Viewport* GlfwOcctView::viewportAt(const Graphic3d_Vec2i& theCursor) const
+{
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+  {
+    const Graphic3d_Vec2i aLocal = theCursor - aViewport->pos;
+    if (aViewport->visible && aLocal.x() >= 0 && aLocal.y() >= 0 && aLocal.x() < aViewport->size.x()
+        && aLocal.y() < aViewport->size.y())
+    {
+      return aViewport.get();
+    }
+  }
+  return nullptr;
+}
+
+// ================================================================
+// Function : activateViewportAt
+// Purpose  :
+// ================================================================
+void GlfwOcctView::activateViewportAt(const Graphic3d_Vec2i& theCursor)
+{
+  if (PressedMouseButtons() != Aspect_VKeyMouse_NONE) { return; }
+
+  Viewport* aViewport = viewportAt(theCursor);
+  if (aViewport == nullptr || aViewport == myActiveViewport) { return; }
+  myActiveViewport = aViewport;
+  myView           = aViewport->view;
+}
+
+// ================================================================
+// Function : toActiveViewport
+// Purpose  :
+// ================================================================
+Graphic3d_Vec2i GlfwOcctView::toActiveViewport(const Graphic3d_Vec2i& theCursor) const
+{
+  // the image of a view is stretched over its window
+  const Graphic3d_Vec2i aLocal = theCursor - myActiveViewport->pos;
+  const Graphic3d_Vec2i aSize  = myActiveViewport->size.cwiseMax(Graphic3d_Vec2i(1, 1));
+  return Graphic3d_Vec2i(int(aLocal.x() * win_data::CONTENT_WIDTH / (float)aSize.x()),
+                         int(aLocal.y() * win_data::CONTENT_HEIGHT / (float)aSize.y()));
 }
 
 void GlfwOcctView::initUI()
@@ -414,6 +621,8 @@ void GlfwOcctView::initUI()
   // setup Platform/Renderer bindings
   ImGui_ImplGlfw_InitForOpenGL(myOcctWindow->getGlfwWindow(), true);
   ImGui_ImplOpenGL3_Init(glsl_version);
+  // frames are paced by FramePacer, waiting for vertical sync as well would add up to a frame of latency
+  glfwSwapInterval(0);
   // setup ImGui style
   ImGui::StyleColorsDark();
 }
@@ -469,6 +678,12 @@ void GlfwOcctView::render()
       if (ImGui::BeginMenu("View"))
       {
         ImGui::MenuItem("Show Demo Window", nullptr, &show_demo_window);
+        ImGui::Separator();
+        // the perspective view always stays open
+        for (size_t i = 1; i < myViewports.size(); ++i)
+        {
+          ImGui::MenuItem(myViewports[i]->name.c_str(), nullptr, &myViewports[i]->open);
+        }
         ImGui::EndMenu();
       }
       ImGui::EndMenuBar();
@@ -495,7 +710,15 @@ void GlfwOcctView::render()
         const float gui_size = .2f;
         ImGui::DockBuilderSplitNode(dock_space_id, ImGuiDir_Left, gui_size, &gui_node, &content_node);
 
-        ImGui::DockBuilderDockWindow(win_data::DockWinId::content.c_str(), content_node);
+        // viewports in a 2x2 grid, the perspective view top left
+        ImGuiID view_nodes[4];
+        ImGui::DockBuilderSplitNode(content_node, ImGuiDir_Left, .5f, &view_nodes[0], &view_nodes[1]);
+        ImGui::DockBuilderSplitNode(view_nodes[0], ImGuiDir_Up, .5f, &view_nodes[0], &view_nodes[2]);
+        ImGui::DockBuilderSplitNode(view_nodes[1], ImGuiDir_Up, .5f, &view_nodes[1], &view_nodes[3]);
+        for (size_t i = 0; i < myViewports.size(); ++i)
+        {
+          ImGui::DockBuilderDockWindow(myViewports[i]->name.c_str(), view_nodes[std::min<size_t>(i, 3)]);
+        }
         ImGui::DockBuilderDockWindow(win_data::DockWinId::gui.c_str(), gui_node);
         ImGui::DockBuilderFinish(dock_space_id);
       }
@@ -510,19 +733,8 @@ void GlfwOcctView::render()
   ImGui::End();
   ImGui::PopStyleVar(3);
   //
-  // render view
-  ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.f, 0.f));
-  ImGui::Begin(win_data::DockWinId::content.c_str(), nullptr, ImGuiWindowFlags_NoScrollbar);
-  {
-    ImVec2 win_pos = ImGui::GetWindowPos();
-    win_data::Content::pos.SetValues(win_pos.x, win_pos.y);
-    ImVec2 win_size = ImGui::GetWindowSize();
-    win_data::Content::size.SetValues(win_size.x, win_size.y);
-
-    ImGui::Image((ImTextureID)(intptr_t)myTexture.glID, win_size, ImVec2(0, 1), ImVec2(1, 0));
-  }
-  ImGui::End();
-  ImGui::PopStyleVar();
+  // render views
+  drawViewports();
   //
   // render UI
   ImGui::Begin(win_data::DockWinId::gui.c_str());
@@ -531,7 +743,7 @@ void GlfwOcctView::render()
     if (ImGui::Button("Load model", ImVec2(avail.x, 0)))
     {
       nfdu8char_t* filepath;
-      nfdu8filteritem_t filter           = { "Geometry", "brep" };
+      nfdu8filteritem_t filter           = { "Geometry", "brep,step,stp,iges,igs" };
       std::filesystem::path default_path = std::filesystem::current_path() / "../external/occt/data/occ";
       nfdresult_t result                 = NFD_OpenDialogU8(&filepath, &filter, 1, default_path.c_str());
       if (result == NFD_OKAY)
@@ -542,10 +754,98 @@ void GlfwOcctView::render()
       else if (result == NFD_CANCEL) {}
       else { printf("Error: %s\n", NFD_GetError()); }
     }
+    if (ImGui::Checkbox("Watch loaded files", &myToWatch)) { setWatching(myToWatch); }
+    if (ImGui::IsItemHovered())
+    {
+      ImGui::SetTooltip("Reload a model when its file is written again; only faces that changed are tested again");
+    }
+    ImGui::Spacing();
+    static HaunchParams params;
+    const double min_distance = 1.0, max_distance = 60.0;
+    const double min_tol = 1e-7, max_tol = 1e-1;
+    const double min_angle = Precision::Angular(), max_angle = FaceIndex::NORMAL_CELL;
+    ImGui::DragScalar(
+        "haunch max distance", ImGuiDataType_Double, &params.max_distance, 0.5f, &min_distance, &max_distance, "%.0f");
+    ImGui::SliderInt("search threads", &params.threads, 1, std::max(1, (int)std::thread::hardware_concurrency()));
+    if (ImGui::CollapsingHeader("Tolerances"))
+    {
+      const ImGuiSliderFlags log_flags = ImGuiSliderFlags_Logarithmic;
+      ImGui::SliderScalar("lateral", ImGuiDataType_Double, &params.lateral_tol, &min_tol, &max_tol, "%.1e", log_flags);
+      ImGui::SliderScalar("offset", ImGuiDataType_Double, &params.offset_tol, &min_tol, &max_tol, "%.1e", log_flags);
+      ImGui::SliderScalar(
+          "angular [rad]", ImGuiDataType_Double, &params.angular_tol, &min_angle, &max_angle, "%.1e", log_flags);
+      const double min_overlap = 0.0, max_overlap = 1.0;
+      ImGui::SliderScalar(
+          "min overlap", ImGuiDataType_Double, &params.min_overlap, &min_overlap, &max_overlap, "%.2f");
+      if (ImGui::IsItemHovered())
+      {
+        ImGui::SetTooltip("0 compares vertices, above 0 matches faces by the overlap of their outlines");
+      }
+      ImGui::SliderScalar(
+          "min area ratio", ImGuiDataType_Double, &params.min_area_ratio, &min_overlap, &max_overlap, "%.2f");
+      if (ImGui::Button("Reset tolerances", ImVec2(avail.x, 0)))
+      {
+        const double aDistance = params.max_distance;
+        const int aThreads     = params.threads;
+        params                 = HaunchParams();
+        params.max_distance    = aDistance;
+        params.threads         = aThreads;
+      }
+      drawSweepPanel(params);
+    }
+    if (ImGui::Button("Find haunches", ImVec2(avail.x, 0)))
+    {
+      for (const HaunchResult& aResult : myResults) { HighlightHaunches(myContext, aResult, false); }
+      try
+      {
+        myResults =
+            ProcessDisplayedShapes(myContext, myDisplayed, myAnalysis, params, myToHighlight && !myToShowThickness);
+      }
+      catch (const Standard_Failure& theFailure)
+      {
+        myResults.clear();
+        Message::DefaultMessenger()->Send(
+            TCollection_AsciiString("Haunch detection failed: ") + theFailure.GetMessageString(), Message_Fail);
+      }
+      for (HaunchResult& aResult : myResults) { GroupRibFeatures(aResult, params); }
+      myResultParams    = params;
+      myToUpdateResults = true;
+      mySelectedFeature = -1;
+      invalidateViewports();
+    }
+    if (ImGui::Checkbox("Highlight haunches", &myToHighlight) && !myToShowThickness)
+    {
+      for (const HaunchResult& aResult : myResults) { HighlightHaunches(myContext, aResult, myToHighlight); }
+      invalidateViewports();
+    }
+    bool pick_faces = myToPickFaces;
+    if (ImGui::Checkbox("Pick faces (Alt+drag for box)", &pick_faces)) { setFacePicking(pick_faces); }
+    if (ImGui::Checkbox("Defer selection until the first pick", &myToDeferSelection) && !myToDeferSelection)
+    {
+      activatePendingSelection();
+    }
+    if (ImGui::IsItemHovered())
+    {
+      ImGui::SetTooltip("Compare \"display\" and \"resident memory\" in the profiler with and without");
+    }
+    ImGui::BeginDisabled(!myToPickFaces);
+    if (ImGui::Button("Find haunches in selection", ImVec2(avail.x, 0)))
+    {
+      findHaunchesInSelection(params, myToHighlight && !myToShowThickness);
+    }
+    ImGui::EndDisabled();
+    if (myToPickFaces) { ImGui::Text("Local search: %.2f ms", myLocalSearchMs); }
+    ImGui::Spacing();
+    static bool export_json = false;
+    ImGui::BeginDisabled(myResults.empty());
+    if (ImGui::Button("Export results", ImVec2(avail.x, 0))) { exportResults(export_json); }
+    ImGui::Checkbox("Also write JSON", &export_json);
+    ImGui::EndDisabled();
     ImGui::Spacing();
-    static float dist = 20.f;
-    ImGui::DragFloat("haunch max distance", &dist, 0.5f, 1.0f, 60.f, "%.0f");
-    if (ImGui::Button("Find haunches", ImVec2(avail.x, 0))) { ProcessDisplayedShapes(myContext, dist); }
+    drawFeaturesPanel();
+    drawThicknessPanel(params, myToHighlight);
+    drawLibraryPanel();
+    drawProfilerPanel();
   }
   ImGui::End();
   //
@@ -554,14 +854,711 @@ void GlfwOcctView::render()
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+void GlfwOcctView::drawViewports()
+{
+  ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.f, 0.f));
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+  {
+    aViewport->visible = false;
+    if (!aViewport->open) { continue; }
+
+    bool* anOpen = aViewport == myViewports.front() ? nullptr : &aViewport->open;
+    // a window docked behind another tab is not drawn, and neither is its view rendered
+    if (ImGui::Begin(aViewport->name.c_str(), anOpen, ImGuiWindowFlags_NoScrollbar) && aViewport->open)
+    {
+      const ImVec2 aPos  = ImGui::GetCursorScreenPos();
+      const ImVec2 aSize = ImGui::GetContentRegionAvail();
+      aViewport->pos.SetValues(int(aPos.x), int(aPos.y));
+      aViewport->size.SetValues(int(aSize.x), int(aSize.y));
+      aViewport->visible = true;
+
+      ImGui::Image((ImTextureID)(intptr_t)aViewport->glID, aSize, ImVec2(0, 1), ImVec2(1, 0));
+    }
+    ImGui::End();
+  }
+  ImGui::PopStyleVar();
+
+  // input of a closed viewport goes back to the perspective view
+  if (!myActiveViewport->open)
+  {
+    ResetViewInput();
+    myActiveViewport = myViewports.front().get();
+    myView           = myActiveViewport->view;
+  }
+}
+
 void GlfwOcctView::loadModel(const char* filepath)
 {
-  TopoDS_Shape shape;
-  BRep_Builder builder;
-  if (!BRepTools::Read(shape, filepath, builder)) { throw std::runtime_error("Failed to read BREP file"); }
-  Message::DefaultMessenger()->Send(TCollection_AsciiString("Loaded file: ") + filepath + "\n", Message_Info);
+  Message::DefaultMessenger()->Send(TCollection_AsciiString("Loading file: ") + filepath + "\n", Message_Info);
+  // loading a file again replaces the models it produced before, together with their analysis
+  AIS_ListOfInteractive aStale;
+  for (AIS_ListIteratorOfListOfInteractive anIter(myDisplayed); anIter.More(); anIter.Next())
+  {
+    const std::string* aSource = mySources.Seek(anIter.Value());
+    if (aSource != nullptr && *aSource == filepath) { aStale.Append(anIter.Value()); }
+  }
+  for (AIS_ListIteratorOfListOfInteractive anIter(aStale); anIter.More(); anIter.Next())
+  {
+    removeShape(anIter.Value());
+  }
+  // a reload of the file in progress has no models left to replace and displays its shapes as new ones
+  if (myReloads.count(filepath) != 0) { return; }
+  myLoader.load_async(filepath);
+}
+
+void GlfwOcctView::reloadModel(const std::string& thePath)
+{
+  Reload aReload;
+  for (AIS_ListIteratorOfListOfInteractive anIter(myDisplayed); anIter.More(); anIter.Next())
+  {
+    const std::string* aSource = mySources.Seek(anIter.Value());
+    if (aSource != nullptr && *aSource == thePath) { aReload.stale.Append(anIter.Value()); }
+  }
+  if (aReload.stale.IsEmpty()) { return; }
+
+  Message::DefaultMessenger()->Send(TCollection_AsciiString("Reloading file: ") + thePath.c_str() + "\n",
+                                    Message_Info);
+  myReloads[thePath] = aReload;
+  myLoader.load_async(thePath);
+}
+
+void GlfwOcctView::pollWatcher()
+{
+  for (const std::string& aPath : myWatcher.take_changed()) { myQueuedReloads.insert(aPath); }
+  // one reload at a time, so the shapes coming back are not mistaken for those of another load of the file
+  if (!myReloads.empty() || myQueuedReloads.empty()) { return; }
+  for (const std::string& aPath : myQueuedReloads) { reloadModel(aPath); }
+  myQueuedReloads.clear();
+}
 
-  Handle(AIS_Shape) aisShape = new AIS_Shape(shape);
+void GlfwOcctView::setWatching(bool theToWatch)
+{
+  myToWatch = theToWatch;
+  for (NCollection_DataMap<Handle(AIS_InteractiveObject), std::string>::Iterator anIter(mySources); anIter.More();
+       anIter.Next())
+  {
+    if (theToWatch) { myWatcher.watch(anIter.Value()); }
+    else { myWatcher.unwatch(anIter.Value()); }
+  }
+  if (!theToWatch) { myQueuedReloads.clear(); }
+}
+
+void GlfwOcctView::pollLoader()
+{
+  for (const std::string& anError : myLoader.take_errors())
+  {
+    Message::DefaultMessenger()->Send(TCollection_AsciiString("Failed to load ") + anError.c_str(), Message_Fail);
+  }
+  for (const LoadedShape& aLoaded : myLoader.take_ready())
+  {
+    Message::DefaultMessenger()->Send(TCollection_AsciiString("Loaded shape from: ") + aLoaded.source.c_str() + "\n",
+                                      Message_Info);
+    // roots of a reloaded file take the place of its models in order
+    const auto aReload = myReloads.find(aLoaded.path);
+    if (aReload != myReloads.end() && !aReload->second.stale.IsEmpty())
+    {
+      const Handle(AIS_InteractiveObject) anObj = aReload->second.stale.First();
+      aReload->second.stale.RemoveFirst();
+      aReload->second.replaced = true;
+      replaceShape(anObj, aLoaded);
+    }
+    else { displayShape(aLoaded); }
+  }
+  for (const std::string& aPath : myLoader.take_finished())
+  {
+    const auto aReload = myReloads.find(aPath);
+    if (aReload == myReloads.end()) { continue; }
+    // a failed reload, e.g. of a file caught half written, keeps the previous models
+    if (aReload->second.replaced)
+    {
+      const AIS_ListOfInteractive aLeft = aReload->second.stale;
+      for (AIS_ListIteratorOfListOfInteractive anIter(aLeft); anIter.More(); anIter.Next())
+      {
+        removeShape(anIter.Value());
+      }
+    }
+    myReloads.erase(aReload);
+  }
+  myAnalysis.prune(myContext);
+}
+
+void GlfwOcctView::displayShape(const LoadedShape& theLoaded)
+{
+  // the loader only computed the coarse triangulation, finer levels are meshed once the view needs them
+  Handle(AIS_ColoredShape) aisShape = new AIS_ColoredShape(theLoaded.shape);
+  aisShape->Attributes()->SetAutoTriangulation(false);
+  myMeshLods.Bind(aisShape, theLoaded.lod);
+  mySources.Bind(aisShape, theLoaded.path);
+  if (myToWatch) { myWatcher.watch(theLoaded.path); }
+  myDisplayed.Append(aisShape);
   // myContext->Display(aisShape, Standard_True);
-  myContext->Display(aisShape, AIS_Shaded, 0, false);
+  // without a selection mode no sensitive entities are computed; they are built on the first pick instead
+  const auto aStart = std::chrono::steady_clock::now();
+  myContext->Display(aisShape, AIS_Shaded, myToDeferSelection ? -1 : selectionMode(), false);
+  Profiler::instance().record(
+      "display " + theLoaded.source,
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count());
+  if (myToDeferSelection) { myPendingSelection.Add(aisShape); }
+  // the fixed views keep every model in frame, the perspective view is left where the user put it
+  for (size_t i = 1; i < myViewports.size(); ++i) { myViewports[i]->view->FitAll(0.01, false); }
+  invalidateViewports();
+  recordMemory();
+}
+
+int GlfwOcctView::selectionMode() const
+{
+  return myToPickFaces ? AIS_Shape::SelectionMode(TopAbs_FACE) : 0;
+}
+
+void GlfwOcctView::activatePendingSelection()
+{
+  if (myPendingSelection.IsEmpty()) { return; }
+
+  {
+    Profiler::Scope aTimer("selection activation");
+    for (NCollection_Map<Handle(AIS_InteractiveObject)>::Iterator anIter(myPendingSelection); anIter.More();
+         anIter.Next())
+    {
+      myContext->Activate(anIter.Value(), selectionMode());
+    }
+  }
+  myPendingSelection.Clear();
+  recordMemory();
+}
+
+void GlfwOcctView::recordMemory()
+{
+  OSD_MemInfo aMemInfo;
+  Profiler::instance().record("resident memory", (double)aMemInfo.ValueMiB(OSD_MemInfo::MemWorkingSet), "MB");
+}
+
+void GlfwOcctView::replaceShape(const Handle(AIS_InteractiveObject)& theObj, const LoadedShape& theLoaded)
+{
+  Handle(AIS_ColoredShape) aShape = Handle(AIS_ColoredShape)::DownCast(theObj);
+  if (aShape.IsNull()) { return; }
+
+  // the object stays in the context, so its place in the results, its selection and its source are kept
+  aShape->ClearCustomAspects();
+  aShape->SetShape(theLoaded.shape);
+  myMeshLods.Bind(aShape, theLoaded.lod);
+  myAnalysis.invalidate(aShape);
+  myThicknessMaps.erase(std::remove_if(myThicknessMaps.begin(),
+                                       myThicknessMaps.end(),
+                                       [&](const ThicknessMap& aMap) { return aMap.object == theObj; }),
+                        myThicknessMaps.end());
+  mySelectedFeature = -1;
+  myContext->Redisplay(aShape, false);
+  invalidateViewports();
+  if (!myPendingSelection.Contains(aShape)) { myContext->RecomputeSelectionOnly(aShape); }
+
+  const auto aResult = std::find_if(
+      myResults.begin(), myResults.end(), [&](const HaunchResult& theResult) { return theResult.object == theObj; });
+  if (aResult == myResults.end()) { return; }
+  if (!myToUpdateResults || !aResult->index)
+  {
+    myResults.erase(aResult);
+    return;
+  }
+
+  Profiler::Scope aTimer("update " + theLoaded.source);
+  const std::shared_ptr<const FaceIndex> anIndex = myAnalysis.index(aShape, aResult->index->has_outlines());
+  const FaceDiff aDiff                           = DiffFaces(*aResult->index, *anIndex);
+  *aResult                                       = UpdateHaunches(*aResult, anIndex, aDiff, myResultParams);
+  aResult->object                                = theObj;
+  GroupRibFeatures(*aResult, myResultParams);
+  if (myToHighlight && !myToShowThickness) { HighlightHaunches(myContext, *aResult, true); }
+  Message::DefaultMessenger()->Send(TCollection_AsciiString("Reloaded ") + theLoaded.source.c_str() + ": "
+                                        + int(aDiff.changed.size()) + " faces added or changed, " + aDiff.removed
+                                        + " removed\n",
+                                    Message_Info);
+}
+
+void GlfwOcctView::removeShape(const Handle(AIS_InteractiveObject)& theObj)
+{
+  for (HaunchResult& aResult : myResults)
+  {
+    if (aResult.object == theObj) { HighlightHaunches(myContext, aResult, false); }
+  }
+  myResults.erase(std::remove_if(myResults.begin(),
+                                 myResults.end(),
+                                 [&](const HaunchResult& aResult) { return aResult.object == theObj; }),
+                  myResults.end());
+  myThicknessMaps.erase(std::remove_if(myThicknessMaps.begin(),
+                                       myThicknessMaps.end(),
+                                       [&](const ThicknessMap& aMap) { return aMap.object == theObj; }),
+                        myThicknessMaps.end());
+
+  mySelectedFeature = -1;
+
+  myPendingSelection.Remove(theObj);
+  myContext->Remove(theObj, false);
+  invalidateViewports();
+  myDisplayed.Remove(theObj);
+  myMeshLods.UnBind(theObj);
+  myAnalysis.invalidate(theObj);
+  for (auto& aReload : myReloads) { aReload.second.stale.Remove(theObj); }
+
+  const std::string* aSource = mySources.Seek(theObj);
+  const std::string aPath    = aSource != nullptr ? *aSource : std::string();
+  mySources.UnBind(theObj);
+  for (NCollection_DataMap<Handle(AIS_InteractiveObject), std::string>::Iterator anIter(mySources); anIter.More();
+       anIter.Next())
+  {
+    if (anIter.Value() == aPath) { return; }
+  }
+  myWatcher.unwatch(aPath);
+}
+
+void GlfwOcctView::drawProfilerPanel()
+{
+  if (!ImGui::CollapsingHeader("Profiler")) { return; }
+
+  if (myLoader.busy()) { ImGui::TextUnformatted("Loading..."); }
+  static int fps_cap = (int)myPacer.target_fps();
+  if (ImGui::SliderInt("FPS cap", &fps_cap, 0, 240, fps_cap == 0 ? "off" : "%d")) { myPacer.set_target_fps(fps_cap); }
+  ImGui::Text("Predicted frame work: %.2f ms", myPacer.predicted_work_ms());
+  const std::vector<Profiler::Entry> anEntries = Profiler::instance().snapshot();
+  const ImGuiTableFlags aFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+  if (ImGui::BeginTable("profiler", 3, aFlags))
+  {
+    ImGui::TableSetupColumn("measurement");
+    ImGui::TableSetupColumn("last");
+    ImGui::TableSetupColumn("average");
+    ImGui::TableHeadersRow();
+    for (const Profiler::Entry& anEntry : anEntries)
+    {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(anEntry.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f %s", anEntry.last, anEntry.unit.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f %s", anEntry.average(), anEntry.unit.c_str());
+    }
+    ImGui::EndTable();
+  }
+  if (ImGui::Button("Clear measurements", ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+  {
+    Profiler::instance().clear();
+  }
+}
+
+void GlfwOcctView::updateMeshLods()
+{
+  for (NCollection_DataMap<Handle(AIS_InteractiveObject), std::shared_ptr<MeshLod>>::Iterator anIter(myMeshLods);
+       anIter.More();
+       anIter.Next())
+  {
+    MeshLod& aLod    = *anIter.Value();
+    bool toRecompute = aLod.poll();
+    const int aLevel = aLod.choose_level(pixelsPerUnit(aLod.bounding_box()));
+    toRecompute      = aLod.request(aLevel) || toRecompute;
+    if (toRecompute)
+    {
+      myContext->Redisplay(anIter.Key(), false);
+      invalidateViewports();
+    }
+  }
+}
+
+double GlfwOcctView::pixelsPerUnit(const Bnd_Box& theBox) const
+{
+  if (theBox.IsVoid()) { return 0.0; }
+
+  Standard_Real aXmin, aYmin, aZmin, aXmax, aYmax, aZmax;
+  theBox.Get(aXmin, aYmin, aZmin, aXmax, aYmax, aZmax);
+
+  // the level has to suit the viewport showing the model largest, as every view draws the same triangulation
+  double aPixels = 0.0;
+  for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+  {
+    if (!aViewport->visible && aViewport.get() != myActiveViewport) { continue; }
+
+    const Handle(Graphic3d_Camera)& aCamera = aViewport->view->Camera();
+    Graphic3d_Vec2d aMin(RealLast(), RealLast()), aMax(RealFirst(), RealFirst());
+    for (int aCorner = 0; aCorner < 8; ++aCorner)
+    {
+      const gp_Pnt aPnt((aCorner & 1) ? aXmax : aXmin, (aCorner & 2) ? aYmax : aYmin, (aCorner & 4) ? aZmax : aZmin);
+      const gp_Pnt aProj = aCamera->Project(aPnt);
+      // a corner behind the eye means the camera is inside or very close to the model
+      if (aProj.Z() < -1.0 || aProj.Z() > 1.0) { return RealLast(); }
+      aMin = aMin.cwiseMin(Graphic3d_Vec2d(aProj.X(), aProj.Y()));
+      aMax = aMax.cwiseMax(Graphic3d_Vec2d(aProj.X(), aProj.Y()));
+    }
+
+    Standard_Integer aWidth = 0, aHeight = 0;
+    aViewport->view->Window()->Size(aWidth, aHeight);
+    aPixels = std::max({ aPixels, (aMax.x() - aMin.x()) * 0.5 * aWidth, (aMax.y() - aMin.y()) * 0.5 * aHeight });
+  }
+  return aPixels / std::sqrt(theBox.SquareExtent());
+}
+
+void GlfwOcctView::setFacePicking(bool theToPickFaces)
+{
+  myToPickFaces = theToPickFaces;
+  myContext->ClearSelected(false);
+
+  AIS_ListOfInteractive aList;
+  myContext->DisplayedObjects(aList);
+  for (AIS_ListIteratorOfListOfInteractive anIter(aList); anIter.More(); anIter.Next())
+  {
+    Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+    if (aShape.IsNull()) { continue; }
+
+    myContext->Deactivate(aShape);
+    if (myToDeferSelection) { myPendingSelection.Add(aShape); }
+    else { myContext->Activate(aShape, selectionMode()); }
+  }
+  invalidateViewports();
+}
+
+void GlfwOcctView::findHaunchesInSelection(const HaunchParams& theParams, bool theToHighlight)
+{
+  const auto aStart = std::chrono::steady_clock::now();
+
+  NCollection_DataMap<Handle(AIS_InteractiveObject), std::vector<int>> aPicked;
+  for (myContext->InitSelected(); myContext->MoreSelected(); myContext->NextSelected())
+  {
+    Handle(StdSelect_BRepOwner) anOwner = Handle(StdSelect_BRepOwner)::DownCast(myContext->SelectedOwner());
+    Handle(AIS_Shape) anObj             = Handle(AIS_Shape)::DownCast(myContext->SelectedInteractive());
+    if (anOwner.IsNull() || anObj.IsNull() || anOwner->Shape().ShapeType() != TopAbs_FACE) { continue; }
+
+    // the index is built on the first pick and reused by every later search on the object
+    const int aFaceId = myAnalysis.index(anObj, theParams.min_overlap > 0.0)->faces().FindIndex(anOwner->Shape());
+    if (aFaceId == 0) { continue; }
+    if (!aPicked.IsBound(anObj)) { aPicked.Bind(anObj, std::vector<int>()); }
+    aPicked.ChangeFind(anObj).push_back(aFaceId);
+  }
+
+  for (const HaunchResult& aResult : myResults) { HighlightHaunches(myContext, aResult, false); }
+  myResults.clear();
+  // results follow the load order, not the order of the map
+  for (AIS_ListIteratorOfListOfInteractive anIter(myDisplayed); anIter.More(); anIter.Next())
+  {
+    const Handle(AIS_InteractiveObject)& anObj = anIter.Value();
+    if (!aPicked.IsBound(anObj)) { continue; }
+    const Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anObj);
+    myResults.push_back(
+        FindHaunchesForFaces(myAnalysis.index(aShape, theParams.min_overlap > 0.0), aPicked.Find(anObj), theParams));
+    myResults.back().object = anObj;
+    GroupRibFeatures(myResults.back(), theParams);
+    if (theToHighlight) { HighlightHaunches(myContext, myResults.back(), true); }
+  }
+  // results of picked faces only are not updated when their model is reloaded
+  myToUpdateResults = false;
+  mySelectedFeature = -1;
+  invalidateViewports();
+
+  myLocalSearchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+void GlfwOcctView::exportResults(bool theToWriteJson)
+{
+  nfdu8char_t* filepath;
+  nfdu8filteritem_t filter = { "Haunch results", "rdr" };
+  nfdresult_t result       = NFD_SaveDialogU8(&filepath, &filter, 1, nullptr, "results.rdr");
+  if (result == NFD_OKAY)
+  {
+    const std::string aPath = filepath;
+    NFD_FreePathU8(filepath);
+    if (!WriteHaunchResults(aPath.c_str(), myResults))
+    {
+      Message::DefaultMessenger()->Send(TCollection_AsciiString("Failed to write: ") + aPath.c_str(), Message_Fail);
+      return;
+    }
+    if (theToWriteJson && !WriteHaunchResultsJson((aPath + ".json").c_str(), myResults))
+    {
+      Message::DefaultMessenger()->Send(TCollection_AsciiString("Failed to write: ") + aPath.c_str() + ".json",
+                                        Message_Fail);
+      return;
+    }
+    Message::DefaultMessenger()->Send(TCollection_AsciiString("Exported results: ") + aPath.c_str(), Message_Info);
+  }
+  else if (result == NFD_ERROR) { printf("Error: %s\n", NFD_GetError()); }
+}
+
+void GlfwOcctView::drawFeaturesPanel()
+{
+  if (!ImGui::CollapsingHeader("Rib features")) { return; }
+
+  size_t aCount = 0;
+  for (const HaunchResult& aResult : myResults) { aCount += aResult.features.size(); }
+  ImGui::Text("%zu rib features, click one to zoom", aCount);
+  if (aCount == 0) { return; }
+
+  const ImGuiTableFlags aFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+  if (!ImGui::BeginTable("features", 5, aFlags, ImVec2(0, 200))) { return; }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("#");
+  ImGui::TableSetupColumn("thickness");
+  ImGui::TableSetupColumn("length");
+  ImGui::TableSetupColumn("height");
+  ImGui::TableSetupColumn("faces");
+  ImGui::TableHeadersRow();
+  // features of all results form one list, and only the visible rows are drawn
+  ImGuiListClipper aClipper;
+  aClipper.Begin((int)aCount);
+  while (aClipper.Step())
+  {
+    size_t aResult = 0, aFirst = 0;
+    for (int aRow = aClipper.DisplayStart; aRow < aClipper.DisplayEnd; ++aRow)
+    {
+      while (size_t(aRow) - aFirst >= myResults[aResult].features.size())
+      {
+        aFirst += myResults[aResult++].features.size();
+      }
+      const RibFeature& aFeature = myResults[aResult].features[size_t(aRow) - aFirst];
+
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      char aLabel[16];
+      std::snprintf(aLabel, sizeof(aLabel), "%d", aRow + 1);
+      if (ImGui::Selectable(aLabel, mySelectedFeature == aRow, ImGuiSelectableFlags_SpanAllColumns))
+      {
+        mySelectedFeature = aRow;
+        // every viewport zooms to the feature, each keeping its direction
+        for (const std::unique_ptr<Viewport>& aViewport : myViewports)
+        {
+          if (!aFeature.box.IsVoid()) { aViewport->view->FitAll(aFeature.box, 0.1, false); }
+        }
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3g", aFeature.thickness);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3g", aFeature.length);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3g", aFeature.height);
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu", aFeature.faces.size());
+    }
+  }
+  ImGui::EndTable();
+}
+
+void GlfwOcctView::drawLibraryPanel()
+{
+  if (!ImGui::CollapsingHeader("Part library")) { return; }
+
+  ImGui::InputText("library", &myLibraryPath);
+  if (myLibraryPath != myLoadedLibrary)
+  {
+    // a path that cannot be read leaves an empty library, adding then rewrites the file
+    if (!myLibrary.load(myLibraryPath))
+    {
+      Message::DefaultMessenger()->Send(TCollection_AsciiString("Failed to read library: ") + myLibraryPath.c_str(),
+                                        Message_Fail);
+    }
+    myLoadedLibrary = myLibraryPath;
+    mySimilar.clear();
+  }
+  ImGui::Text("%zu parts", myLibrary.size());
+  ImGui::SliderInt("similar parts", &mySimilarCount, 1, 50);
+
+  ImGui::BeginDisabled(myResults.empty());
+  if (ImGui::Button("Add loaded parts"))
+  {
+    // results of one file make one part, named like the batch runs name it
+    std::map<std::string, std::vector<HaunchResult>> aParts;
+    for (const HaunchResult& aResult : myResults)
+    {
+      const std::string* aSource = mySources.Seek(aResult.object);
+      if (aSource == nullptr) { continue; }
+      aParts[std::filesystem::absolute(*aSource).lexically_normal().string()].push_back(aResult);
+    }
+    for (const auto& [aName, aResults] : aParts) { myLibrary.add(aName, ComputePartSignature(aResults)); }
+    if (!myLibrary.save(myLibraryPath))
+    {
+      Message::DefaultMessenger()->Send(TCollection_AsciiString("Failed to write: ") + myLibraryPath.c_str(),
+                                        Message_Fail);
+    }
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Find similar"))
+  {
+    mySimilar = myLibrary.nearest(ComputePartSignature(myResults), size_t(mySimilarCount));
+  }
+  ImGui::EndDisabled();
+  if (mySimilar.empty()) { return; }
+
+  const ImGuiTableFlags aFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+  if (!ImGui::BeginTable("similar", 2, aFlags, ImVec2(0, 200))) { return; }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("part", ImGuiTableColumnFlags_WidthStretch);
+  ImGui::TableSetupColumn("distance");
+  ImGui::TableHeadersRow();
+  for (const SimilarPart& aPart : mySimilar)
+  {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(aPart.name.c_str());
+    ImGui::TableNextColumn();
+    ImGui::Text("%.4f", aPart.distance);
+  }
+  ImGui::EndTable();
+}
+
+void GlfwOcctView::drawThicknessPanel(const HaunchParams& theParams, bool theToHighlight)
+{
+  if (!ImGui::CollapsingHeader("Thickness map")) { return; }
+
+  static constexpr int THE_BINS     = 32;
+  static constexpr int THE_SEGMENTS = 16;
+  const float aWidth                = ImGui::GetContentRegionAvail().x;
+  if (ImGui::Button("Compute thickness map", ImVec2(aWidth, 0)))
+  {
+    showThickness(false, theToHighlight);
+    myThicknessMaps.clear();
+    for (AIS_ListIteratorOfListOfInteractive anIter(myDisplayed); anIter.More(); anIter.Next())
+    {
+      Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+      if (aShape.IsNull() || !myContext->IsDisplayed(aShape)) { continue; }
+      myThicknessMaps.push_back(
+          ComputeThicknessMap(myAnalysis.index(aShape), theParams.max_distance, theParams.angular_tol));
+      myThicknessMaps.back().object = aShape;
+    }
+
+    myThicknessMin = RealLast();
+    myThicknessMax = 0.0;
+    for (const ThicknessMap& aMap : myThicknessMaps)
+    {
+      if (aMap.faces.empty()) { continue; }
+      myThicknessMin = std::min(myThicknessMin, aMap.min);
+      myThicknessMax = std::max(myThicknessMax, aMap.max);
+    }
+    if (myThicknessMin > myThicknessMax) { myThicknessMin = myThicknessMax = 0.0; }
+    myThicknessHistogram = ThicknessHistogram(myThicknessMaps, myThicknessMin, myThicknessMax, THE_BINS);
+    showThickness(true, theToHighlight);
+  }
+  if (myThicknessMaps.empty()) { return; }
+
+  bool aToShow = myToShowThickness;
+  if (ImGui::Checkbox("Color faces by thickness", &aToShow)) { showThickness(aToShow, theToHighlight); }
+
+  // legend: the color ramp with the thickness at both ends
+  ImDrawList* aDrawList = ImGui::GetWindowDrawList();
+  const ImVec2 aPos     = ImGui::GetCursorScreenPos();
+  const float aHeight   = ImGui::GetFrameHeight();
+  for (int aSegment = 0; aSegment < THE_SEGMENTS; ++aSegment)
+  {
+    const ImU32 aLeft  = imColor(ThicknessColor(double(aSegment) / THE_SEGMENTS));
+    const ImU32 aRight = imColor(ThicknessColor(double(aSegment + 1) / THE_SEGMENTS));
+    aDrawList->AddRectFilledMultiColor(ImVec2(aPos.x + aWidth * aSegment / THE_SEGMENTS, aPos.y),
+                                       ImVec2(aPos.x + aWidth * (aSegment + 1) / THE_SEGMENTS, aPos.y + aHeight),
+                                       aLeft,
+                                       aRight,
+                                       aRight,
+                                       aLeft);
+  }
+  ImGui::Dummy(ImVec2(aWidth, aHeight));
+  char aMaxLabel[32];
+  std::snprintf(aMaxLabel, sizeof(aMaxLabel), "%.3g", myThicknessMax);
+  ImGui::Text("%.3g", myThicknessMin);
+  ImGui::SameLine(aWidth - ImGui::CalcTextSize(aMaxLabel).x);
+  ImGui::TextUnformatted(aMaxLabel);
+
+  size_t aFaceCount = 0;
+  for (const ThicknessMap& aMap : myThicknessMaps) { aFaceCount += aMap.faces.size(); }
+  ImGui::Text("%zu faces with an opposite face", aFaceCount);
+  ImGui::PlotHistogram("##thickness",
+                       myThicknessHistogram.data(),
+                       (int)myThicknessHistogram.size(),
+                       0,
+                       "faces per thickness",
+                       0.0f,
+                       FLT_MAX,
+                       ImVec2(aWidth, 80.0f));
+}
+
+void GlfwOcctView::showThickness(bool theToShow, bool theToHighlight)
+{
+  // both use sub-shape colors of the same presentation, so only one of them is shown at a time
+  if (theToShow)
+  {
+    for (const HaunchResult& aResult : myResults) { HighlightHaunches(myContext, aResult, false); }
+  }
+  for (const ThicknessMap& aMap : myThicknessMaps)
+  {
+    ShowThicknessMap(myContext, aMap, myThicknessMin, myThicknessMax, theToShow);
+  }
+  if (!theToShow && theToHighlight)
+  {
+    for (const HaunchResult& aResult : myResults) { HighlightHaunches(myContext, aResult, true); }
+  }
+  myToShowThickness = theToShow;
+  invalidateViewports();
+}
+
+void GlfwOcctView::drawSweepPanel(const HaunchParams& theParams)
+{
+  static std::string distances, lateral, angular;
+  static std::vector<HaunchSweepCount> counts;
+
+  ImGui::Separator();
+  ImGui::TextUnformatted("Sweep");
+  ImGui::InputTextWithHint("distances", "5, 10, 20", &distances);
+  ImGui::InputTextWithHint("lateral", "1e-4, 1e-3", &lateral);
+  ImGui::InputTextWithHint("angular", "1e-12, 1e-6", &angular);
+  if (ImGui::Button("Run sweep", ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+  {
+    const auto axis = [](const std::string& theList, double theFallback) {
+      std::vector<double> aValues = ParseValueList(theList);
+      if (aValues.empty()) { aValues.push_back(theFallback); }
+      return aValues;
+    };
+    HaunchSweep aSweep;
+    aSweep.max_distances  = axis(distances, theParams.max_distance);
+    aSweep.lateral_tols   = axis(lateral, theParams.lateral_tol);
+    aSweep.angular_tols   = axis(angular, theParams.angular_tol);
+    aSweep.offset_tol     = theParams.offset_tol;
+    aSweep.min_overlap    = theParams.min_overlap;
+    aSweep.min_area_ratio = theParams.min_area_ratio;
+
+    counts.clear();
+    if (*std::max_element(aSweep.angular_tols.begin(), aSweep.angular_tols.end()) > FaceIndex::NORMAL_CELL)
+    {
+      Message::DefaultMessenger()->Send(
+          TCollection_AsciiString("Sweep: angular tolerances above ") + FaceIndex::NORMAL_CELL
+              + " rad are beyond the resolution of the face index",
+          Message_Fail);
+      return;
+    }
+    AIS_ListOfInteractive aList;
+    myContext->DisplayedObjects(aList);
+    for (AIS_ListIteratorOfListOfInteractive anIter(aList); anIter.More(); anIter.Next())
+    {
+      Handle(AIS_Shape) aShape = Handle(AIS_Shape)::DownCast(anIter.Value());
+      if (aShape.IsNull()) { continue; }
+
+      const std::vector<HaunchSweepCount> aCounts =
+          SweepHaunches(*myAnalysis.index(aShape, aSweep.min_overlap > 0.0), aSweep);
+      if (counts.empty()) { counts = aCounts; }
+      else
+      {
+        for (size_t i = 0; i < counts.size(); ++i) { counts[i].hits += aCounts[i].hits; }
+      }
+    }
+  }
+
+  const ImGuiTableFlags table_flags = ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY;
+  if (!counts.empty() && ImGui::BeginTable("sweep", 4, table_flags, ImVec2(0, 150)))
+  {
+    ImGui::TableSetupColumn("distance");
+    ImGui::TableSetupColumn("lateral");
+    ImGui::TableSetupColumn("angular");
+    ImGui::TableSetupColumn("hits");
+    ImGui::TableHeadersRow();
+    for (const HaunchSweepCount& aCount : counts)
+    {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%g", aCount.max_distance);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1e", aCount.lateral_tol);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1e", aCount.angular_tol);
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu", aCount.hits);
+    }
+    ImGui::EndTable();
+  }
 }
@@ -23,11 +23,27 @@
 #define _GlfwOcctView_Header
 
 #include "GlfwOcctWindow.h"
+#include "analysis_cache.h"
+#include "file_watcher.h"
+#include "frame_pacer.h"
+#include "frame_readback.h"
+#include "haunch.h"
+#include "mesh_lod.h"
+#include "model_loader.h"
+#include "part_library.h"
+#include "thickness.h"
 
 #include <AIS_InteractiveContext.hxx>
 #include <AIS_ViewController.hxx>
+#include <Graphic3d_WorldViewProjState.hxx>
+#include <NCollection_DataMap.hxx>
+#include <NCollection_Map.hxx>
 #include <V3d_View.hxx>
 
+#include <map>
+#include <memory>
+#include <set>
+
 //! Sample class creating 3D Viewer within GLFW window.
 class GlfwOcctView : protected AIS_ViewController
 {
@@ -42,6 +58,23 @@ class GlfwOcctView : protected AIS_ViewController
   void run();
 
  private:
+  //! Dockable window showing one view of the shared viewer. Views share the context and its presentations,
+  //! so triangulations and their GPU buffers exist once however many viewports show them.
+  struct Viewport
+  {
+    std::string name; //!< title of the window
+    Handle(V3d_View) view;
+    bool open    = true;
+    bool visible = false; //!< open and not hidden behind another tab of its dock node
+    Graphic3d_Vec2i pos; //!< window position in the GLFW window
+    Graphic3d_Vec2i size;
+    FrameReadback readback; //!< render targets of the view, kept while the view size does not change
+    Image_PixMap pixMap;
+    uint32_t glID = 0;
+    Graphic3d_WorldViewProjState camera; //!< camera of the last rendered frame
+    size_t revision = 0; //!< scene revision of the last rendered frame, 0 to render the next frame
+  };
+
   //! Create GLFW window.
   void initWindow(int theWidth, int theHeight, const char* theTitle);
 
@@ -63,8 +96,92 @@ class GlfwOcctView : protected AIS_ViewController
 
   void render();
 
+  //! Render the viewports whose camera or scene changed and upload the frames read back into their textures.
+  //! Returns the input time of the frame the active viewport shows now, zero when it shows no new frame.
+  FramePacer::Clock::time_point renderViewports(FramePacer::Clock::time_point theInputTime);
+
+  //! Draw the image of every open viewport into its dockable window.
+  void drawViewports();
+
+  //! Viewport under the cursor, nullptr when there is none.
+  Viewport* viewportAt(const Graphic3d_Vec2i& theCursor) const;
+
+  //! Send input to the viewport under the cursor, unless a drag started in another one is in progress.
+  void activateViewportAt(const Graphic3d_Vec2i& theCursor);
+
+  //! Cursor position in the pixels of the active viewport.
+  Graphic3d_Vec2i toActiveViewport(const Graphic3d_Vec2i& theCursor) const;
+
+  //! The displayed scene changed, so every viewport has to be rendered again.
+  void invalidateViewports() { ++mySceneRevision; }
+
+  //! Start loading a BREP, STEP or IGES file in the background.
   void loadModel(const char* filepath);
 
+  //! Display shapes the loader has finished since the previous frame.
+  void pollLoader();
+
+  //! Display a loaded shape together with its triangulation levels.
+  void displayShape(const LoadedShape& theLoaded);
+
+  //! Load a written file again, keeping its models on display until the new shapes arrive.
+  void reloadModel(const std::string& thePath);
+
+  //! Start the reloads of files the watcher reports as written.
+  void pollWatcher();
+
+  //! Watch the files of loaded models, or stop watching them.
+  void setWatching(bool theToWatch);
+
+  //! Put a reloaded shape into an existing model and update its results from the faces that changed.
+  void replaceShape(const Handle(AIS_InteractiveObject)& theObj, const LoadedShape& theLoaded);
+
+  //! Remove a model from the view together with its results and cached analysis.
+  void removeShape(const Handle(AIS_InteractiveObject)& theObj);
+
+  //! Table of the measurements collected by Profiler.
+  void drawProfilerPanel();
+
+  //! Pick the triangulation level of every loaded shape from its projected size.
+  void updateMeshLods();
+
+  //! Approximate number of pixels covered by one model unit inside the box, in the visible viewport
+  //! showing it largest.
+  double pixelsPerUnit(const Bnd_Box& theBox) const;
+
+  //! Switch displayed shapes between whole object selection and face picking.
+  void setFacePicking(bool theToPickFaces);
+
+  //! Selection mode shapes are activated in: whole objects, or faces while picking faces.
+  int selectionMode() const;
+
+  //! Activate the selection of shapes whose sensitive entities were deferred.
+  void activatePendingSelection();
+
+  //! Record the resident memory of the process in the profiler.
+  void recordMemory();
+
+  //! Run the detector only for the faces picked in the viewport.
+  void findHaunchesInSelection(const HaunchParams& theParams, bool theToHighlight);
+
+  //! Sweep inputs and the table of hit counts per setting.
+  void drawSweepPanel(const HaunchParams& theParams);
+
+  //! Ask for a destination and write the last detection results.
+  void exportResults(bool theToWriteJson);
+
+  //! Rib features of the last detection, zooming to the one clicked.
+  void drawFeaturesPanel();
+
+  //! Thickness map computation, legend and histogram.
+  void drawThicknessPanel(const HaunchParams& theParams, bool theToHighlight);
+
+  //! Part library file, adding the loaded parts and listing the parts most similar to them.
+  void drawLibraryPanel();
+
+  //! Switch face colors between the thickness map and the haunch highlight.
+  void showThickness(bool theToShow, bool theToHighlight);
+
   //! @name GLWF callbacks
  private:
   //! Window resize event.
@@ -79,6 +196,12 @@ class GlfwOcctView : protected AIS_ViewController
   //! Mouse move event.
   void onMouseMove(int thePosX, int thePosY);
 
+  //! Remember when the first input since the last rendered frame arrived.
+  void noteInput();
+
+  //! Selection highlight is drawn in every viewport.
+  void OnSelectionChanged(const Handle(AIS_InteractiveContext)& theCtx, const Handle(V3d_View)& theView) override;
+
   //! @name GLWF callbacks (static functions)
  private:
   //! GLFW callback redirecting messages into Message::DefaultMessenger().
@@ -119,14 +242,48 @@ class GlfwOcctView : protected AIS_ViewController
 
  private:
   Handle(GlfwOcctWindow) myOcctWindow;
-  Handle(V3d_View) myView;
+  std::vector<std::unique_ptr<Viewport>> myViewports; //!< the free perspective view first, then fixed presets
+  Viewport* myActiveViewport = nullptr; //!< viewport receiving input
+  Handle(V3d_View) myView; //!< view of the active viewport
+  size_t mySceneRevision = 1;
+  Handle(SelectMgr_EntityOwner) myDetected; //!< hovered owner, its highlight changes the scene as well
   Handle(AIS_InteractiveContext) myContext;
-
-  struct
+  std::vector<HaunchResult> myResults;
+  HaunchParams myResultParams; //!< settings myResults were found with
+  bool myToUpdateResults = false; //!< myResults cover whole models and are updated when one is reloaded
+  bool myToHighlight     = true;
+  int mySelectedFeature = -1; //!< row of the rib features table, counted over all results
+  AIS_ListOfInteractive myDisplayed; //!< loaded models in load order, the order results are reported in
+  NCollection_DataMap<Handle(AIS_InteractiveObject), std::string> mySources; //!< file each model was loaded from
+  AnalysisCache myAnalysis;
+  NCollection_DataMap<Handle(AIS_InteractiveObject), std::shared_ptr<MeshLod>> myMeshLods;
+  ModelLoader myLoader;
+  FileWatcher myWatcher;
+  bool myToWatch = false;
+  struct Reload
   {
-    Image_PixMap pixMap;
-    uint32_t glID = 0;
-  } myTexture;
+    AIS_ListOfInteractive stale; //!< models of the file not replaced yet, in load order
+    bool replaced = false;
+  };
+  std::map<std::string, Reload> myReloads; //!< reloads in progress by file
+  std::set<std::string> myQueuedReloads; //!< written files waiting for the reloads in progress
+  bool myToPickFaces = false;
+  bool myToDeferSelection = true;
+  NCollection_Map<Handle(AIS_InteractiveObject)> myPendingSelection; //!< displayed without active selection
+  Graphic3d_Vec2i myLeftPressPos; //!< cursor at the last left button press, tells a pick from an orbit
+  double myLocalSearchMs = 0.0;
+  std::vector<ThicknessMap> myThicknessMaps;
+  std::vector<float> myThicknessHistogram;
+  double myThicknessMin = 0.0;
+  double myThicknessMax = 0.0;
+  bool myToShowThickness = false;
+  PartLibrary myLibrary;
+  std::string myLibraryPath = "parts.rdl";
+  std::string myLoadedLibrary; //!< path myLibrary was read from, it is read again when the input changes
+  std::vector<SimilarPart> mySimilar;
+  int mySimilarCount = 10;
+  FramePacer myPacer;
+  FramePacer::Clock::time_point myInputTime; //!< first input not rendered yet, zero when there is none
 };
 
 #endif // _GlfwOcctView_Header
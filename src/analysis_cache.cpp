@@ -0,0 +1,51 @@
+#include "analysis_cache.h"
+#include "profiler.h"
+
+#include <vector>
+
+std::shared_ptr<const FaceIndex> AnalysisCache::index(const Handle(AIS_Shape)& object, bool with_outlines)
+{
+  if (const Entry* entry = m_entries.Seek(object))
+  {
+    if (!with_outlines || entry->index->has_outlines()) { return entry->index; }
+    invalidate(object);
+  }
+
+  Entry entry;
+  {
+    Profiler::Scope timer("face index");
+    entry.index = std::make_shared<const FaceIndex>(object->Shape(), with_outlines);
+  }
+  entry.bytes = entry.index->memory_bytes();
+  m_bytes += entry.bytes;
+  m_entries.Bind(object, entry);
+  record();
+  return entry.index;
+}
+
+void AnalysisCache::invalidate(const Handle(AIS_InteractiveObject)& object)
+{
+  if (const Entry* entry = m_entries.Seek(object))
+  {
+    // Results still referring to the index keep it alive, but it is no longer the cache's memory
+    m_bytes -= entry->bytes;
+    m_entries.UnBind(object);
+    record();
+  }
+}
+
+void AnalysisCache::prune(const Handle(AIS_InteractiveContext)& context)
+{
+  std::vector<Handle(AIS_InteractiveObject)> removed;
+  for (NCollection_DataMap<Handle(AIS_InteractiveObject), Entry>::Iterator it(m_entries); it.More(); it.Next())
+  {
+    if (context->DisplayStatus(it.Key()) == PrsMgr_DisplayStatus_None) { removed.push_back(it.Key()); }
+  }
+  for (const Handle(AIS_InteractiveObject)& object : removed) { invalidate(object); }
+}
+
+void AnalysisCache::record() const
+{
+  Profiler::instance().record("analysis cache", m_bytes / (1024.0 * 1024.0), "MB");
+  Profiler::instance().record("analysis cache objects", m_entries.Extent(), "");
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "face_index.h"
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <NCollection_DataMap.hxx>
+
+#include <memory>
+
+// Face indices of displayed objects, built the first time an analysis needs them.
+//
+// Detection, thickness analysis and face picking all ask the cache, so an object is summarised at most once
+// and objects that are never analysed cost nothing. Entries must be invalidated when their object leaves
+// the context; prune() catches objects removed by other means. The memory held is recorded in the profiler.
+class AnalysisCache
+{
+ public:
+  // Index of the object's shape. An index without outlines is rebuilt when outlines are asked for.
+  std::shared_ptr<const FaceIndex> index(const Handle(AIS_Shape)& object, bool with_outlines = false);
+
+  bool contains(const Handle(AIS_InteractiveObject)& object) const { return m_entries.IsBound(object); }
+
+  void invalidate(const Handle(AIS_InteractiveObject)& object);
+
+  // Drop the entries of objects the context no longer knows.
+  void prune(const Handle(AIS_InteractiveContext)& context);
+
+  size_t memory_bytes() const { return m_bytes; }
+
+ private:
+  struct Entry
+  {
+    std::shared_ptr<const FaceIndex> index;
+    size_t bytes = 0;
+  };
+
+  void record() const;
+
+  NCollection_DataMap<Handle(AIS_InteractiveObject), Entry> m_entries;
+  size_t m_bytes = 0;
+};
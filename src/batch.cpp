@@ -0,0 +1,514 @@
+#include "batch.h"
+#include "batch_pool.h"
+#include "haunch.h"
+#include "haunch_export.h"
+#include "model_loader.h"
+#include "pair_pipeline.h"
+#include "part_library.h"
+#include "rib_features.h"
+#include "snapshot.h"
+#include "stream_detect.h"
+#include "thickness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace
+{
+  struct BatchOptions
+  {
+    std::vector<std::string> inputs;
+    std::string export_path;
+    std::string json_path;
+    std::string thickness_path;
+    HaunchParams params;
+    std::string sweep_distances;
+    std::string sweep_lateral;
+    std::string sweep_angular;
+    bool stream          = false;
+    size_t memory_budget = StreamOptions().memory_budget;
+    std::string spill_dir;
+    BatchPoolOptions pool;
+    int check_threads      = 0;
+    bool check_pipeline    = false;
+    double max_slowdown    = 0.0;
+    long long expect_pairs = -1;
+    double time_budget_ms  = 0.0;
+    std::string snapshot_dir;
+    std::vector<SnapshotView> snapshot_views = { SnapshotView::Iso };
+    int snapshot_size                        = 512;
+    std::string library_path;
+    int similar = 0;
+
+    bool is_sweep() const { return !sweep_distances.empty() || !sweep_lateral.empty() || !sweep_angular.empty(); }
+    bool uses_pool() const { return inputs.size() > 1 || pool.jobs > 1 || !pool.checkpoint.empty(); }
+  };
+
+  void printUsage()
+  {
+    std::cerr << "usage: RD --batch <model.brep|.step|.iges>... [--max-distance <d>] [--lateral-tol <t>]\n"
+                 "                  [--offset-tol <t>] [--angular-tol <rad>] [--min-overlap <ratio>]\n"
+                 "                  [--export <out.rdr>] [--json <out.json>]\n"
+                 "                  [--sweep-distances <d,...>] [--sweep-lateral <t,...>]\n"
+                 "                  [--sweep-angular <rad,...>] [--stream] [--memory-budget <MB>]\n"
+                 "                  [--spill-dir <dir>] [--input-list <file>] [--jobs <n>]\n"
+                 "                  [--checkpoint <file>] [--threads <n>] [--check-threads <n>]\n"
+                 "                  [--check-pipeline [--max-slowdown <ratio>]] [--min-area-ratio <ratio>]\n"
+                 "                  [--expect-pairs <n> | --truth <file.truth>] [--time-budget <ms>]\n"
+                 "                  [--thickness <out.csv>] [--snapshots <dir>]\n"
+                 "                  [--snapshot-views <iso,front,top,right>] [--snapshot-size <px>]\n"
+                 "                  [--library <parts.rdl> [--similar <k>]]\n";
+  }
+
+  // Expected pair count from a .truth file written by rd_generate.
+  bool readTruth(const char* path, BatchOptions& options)
+  {
+    std::ifstream truth(path);
+    std::string key;
+    while (truth >> key)
+    {
+      if (key == "pairs") { truth >> options.expect_pairs; }
+      else { truth.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); }
+    }
+    if (options.expect_pairs < 0)
+    {
+      std::cerr << "No pair count in " << path << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  bool parseOptions(int argc, char** argv, BatchOptions& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+      const bool has_value  = i + 1 < argc;
+      if (arg == "--batch") { continue; }
+      else if (arg == "--max-distance" && has_value)
+      {
+        options.params.max_distance = std::strtod(argv[++i], nullptr);
+      }
+      else if (arg == "--lateral-tol" && has_value) { options.params.lateral_tol = std::strtod(argv[++i], nullptr); }
+      else if (arg == "--offset-tol" && has_value) { options.params.offset_tol = std::strtod(argv[++i], nullptr); }
+      else if (arg == "--angular-tol" && has_value) { options.params.angular_tol = std::strtod(argv[++i], nullptr); }
+      else if (arg == "--min-overlap" && has_value) { options.params.min_overlap = std::strtod(argv[++i], nullptr); }
+      else if (arg == "--min-area-ratio" && has_value)
+      {
+        options.params.min_area_ratio = std::strtod(argv[++i], nullptr);
+      }
+      else if (arg == "--sweep-distances" && has_value) { options.sweep_distances = argv[++i]; }
+      else if (arg == "--sweep-lateral" && has_value) { options.sweep_lateral = argv[++i]; }
+      else if (arg == "--sweep-angular" && has_value) { options.sweep_angular = argv[++i]; }
+      else if (arg == "--stream") { options.stream = true; }
+      else if (arg == "--memory-budget" && has_value)
+      {
+        options.memory_budget = static_cast<size_t>(std::strtod(argv[++i], nullptr) * (1 << 20));
+      }
+      else if (arg == "--spill-dir" && has_value) { options.spill_dir = argv[++i]; }
+      else if (arg == "--threads" && has_value) { options.params.threads = std::atoi(argv[++i]); }
+      else if (arg == "--check-threads" && has_value) { options.check_threads = std::atoi(argv[++i]); }
+      else if (arg == "--check-pipeline") { options.check_pipeline = true; }
+      else if (arg == "--max-slowdown" && has_value) { options.max_slowdown = std::strtod(argv[++i], nullptr); }
+      else if (arg == "--expect-pairs" && has_value) { options.expect_pairs = std::atoll(argv[++i]); }
+      else if (arg == "--truth" && has_value)
+      {
+        if (!readTruth(argv[++i], options)) { return false; }
+      }
+      else if (arg == "--time-budget" && has_value) { options.time_budget_ms = std::strtod(argv[++i], nullptr); }
+      else if (arg == "--jobs" && has_value) { options.pool.jobs = std::atoi(argv[++i]); }
+      else if (arg == "--checkpoint" && has_value) { options.pool.checkpoint = argv[++i]; }
+      else if (arg == "--input-list" && has_value)
+      {
+        std::ifstream list(argv[++i]);
+        if (!list)
+        {
+          std::cerr << "Cannot read input list: " << argv[i] << "\n";
+          return false;
+        }
+        for (std::string line; std::getline(list, line);)
+        {
+          if (!line.empty()) { options.inputs.push_back(line); }
+        }
+      }
+      else if (arg == "--export" && has_value) { options.export_path = argv[++i]; }
+      else if (arg == "--json" && has_value) { options.json_path = argv[++i]; }
+      else if (arg == "--thickness" && has_value) { options.thickness_path = argv[++i]; }
+      else if (arg == "--snapshots" && has_value) { options.snapshot_dir = argv[++i]; }
+      else if (arg == "--snapshot-views" && has_value)
+      {
+        if (!ParseSnapshotViews(argv[++i], options.snapshot_views))
+        {
+          std::cerr << "Unknown snapshot view in: " << argv[i] << "\n";
+          return false;
+        }
+      }
+      else if (arg == "--snapshot-size" && has_value) { options.snapshot_size = std::atoi(argv[++i]); }
+      else if (arg == "--library" && has_value) { options.library_path = argv[++i]; }
+      else if (arg == "--similar" && has_value) { options.similar = std::atoi(argv[++i]); }
+      else if (!arg.empty() && arg[0] != '-') { options.inputs.push_back(arg); }
+      else
+      {
+        std::cerr << "Unknown or incomplete option: " << arg << "\n";
+        return false;
+      }
+    }
+    // FaceIndex::partners() never returns faces tilted further, so larger values would silently miss pairs
+    if (options.params.angular_tol > FaceIndex::NORMAL_CELL)
+    {
+      std::cerr << "--angular-tol above " << FaceIndex::NORMAL_CELL
+                << " rad is beyond the resolution of the face index\n";
+      return false;
+    }
+    return !options.inputs.empty();
+  }
+
+  std::vector<double> sweepAxis(const std::string& list, double fallback)
+  {
+    std::vector<double> values = ParseValueList(list);
+    if (values.empty()) { values.push_back(fallback); }
+    return values;
+  }
+
+  int runSweep(const TopoDS_Shape& shape, const BatchOptions& options)
+  {
+    HaunchSweep sweep;
+    sweep.max_distances  = sweepAxis(options.sweep_distances, options.params.max_distance);
+    sweep.lateral_tols   = sweepAxis(options.sweep_lateral, options.params.lateral_tol);
+    sweep.angular_tols   = sweepAxis(options.sweep_angular, options.params.angular_tol);
+    sweep.offset_tol     = options.params.offset_tol;
+    sweep.min_overlap    = options.params.min_overlap;
+    sweep.min_area_ratio = options.params.min_area_ratio;
+    if (*std::max_element(sweep.angular_tols.begin(), sweep.angular_tols.end()) > FaceIndex::NORMAL_CELL)
+    {
+      std::cerr << "Angular tolerances above " << FaceIndex::NORMAL_CELL
+                << " rad are beyond the resolution of the face index\n";
+      return EXIT_FAILURE;
+    }
+
+    const FaceIndex index(shape, sweep.min_overlap > 0.0);
+    std::printf("%14s %14s %14s %10s\n", "max_distance", "lateral_tol", "angular_tol", "hits");
+    for (const HaunchSweepCount& count : SweepHaunches(index, sweep))
+    {
+      std::printf("%14g %14g %14g %10zu\n", count.max_distance, count.lateral_tol, count.angular_tol, count.hits);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // Exports computed with one thread and, repeatedly, with check_threads threads must be byte-identical.
+  int runThreadCheck(const BatchOptions& options)
+  {
+    static constexpr int RUNS = 3;
+
+    int status = EXIT_SUCCESS;
+    for (const std::string& path : options.inputs)
+    {
+      TopoDS_Shape shape;
+      if (!ReadModel(path, shape))
+      {
+        std::cerr << "Failed to read model: " << path << "\n";
+        status = EXIT_FAILURE;
+        continue;
+      }
+
+      const auto index      = std::make_shared<const FaceIndex>(shape, options.params.min_overlap > 0.0);
+      HaunchParams params   = options.params;
+      params.threads        = 1;
+      const std::string one = SerializeHaunchResults({ FindHaunches(index, params) });
+
+      params.threads = options.check_threads;
+      bool identical = true;
+      for (int run = 0; run < RUNS && identical; ++run)
+      {
+        identical = SerializeHaunchResults({ FindHaunches(index, params) }) == one;
+      }
+      std::cout << path << ": exports with 1 and " << options.check_threads << " threads "
+                << (identical ? "are identical" : "DIFFER") << "\n";
+      if (!identical) { status = EXIT_FAILURE; }
+    }
+    return status;
+  }
+
+  // The pair search with the pipeline picked for the params against the reference pipeline wrapping the
+  // previous hard-wired matcher: exports must be byte-identical, and both are timed over a few runs.
+  int runPipelineCheck(const BatchOptions& options)
+  {
+    static constexpr int RUNS = 3;
+
+    const auto best = [&](auto search) {
+      double fastest = std::numeric_limits<double>::infinity();
+      std::string bytes;
+      for (int run = 0; run < RUNS; ++run)
+      {
+        const auto start          = std::chrono::steady_clock::now();
+        const HaunchResult result = search();
+        const auto elapsed        = std::chrono::steady_clock::now() - start;
+        fastest                   = std::min(fastest, std::chrono::duration<double, std::milli>(elapsed).count());
+        bytes                     = SerializeHaunchResults({ result });
+      }
+      return std::make_pair(fastest, bytes);
+    };
+
+    int status = EXIT_SUCCESS;
+    for (const std::string& path : options.inputs)
+    {
+      TopoDS_Shape shape;
+      if (!ReadModel(path, shape))
+      {
+        std::cerr << "Failed to read model: " << path << "\n";
+        status = EXIT_FAILURE;
+        continue;
+      }
+
+      const auto index     = std::make_shared<const FaceIndex>(shape, options.params.min_overlap > 0.0);
+      const auto pipeline  = best([&]() { return FindHaunches(index, options.params); });
+      const auto reference = best([&]() { return FindHaunchesWith<ReferencePipeline>(index, options.params); });
+      const bool identical = pipeline.second == reference.second;
+      std::cout << path << ": pipeline " << pipeline.first << " ms, reference " << reference.first << " ms, exports "
+                << (identical ? "are identical" : "DIFFER") << "\n";
+      if (!identical) { status = EXIT_FAILURE; }
+      if (options.max_slowdown > 0.0 && pipeline.first > options.max_slowdown * reference.first)
+      {
+        std::cerr << path << ": pipeline more than " << options.max_slowdown << " times slower than the reference\n";
+        status = EXIT_FAILURE;
+      }
+    }
+    return status;
+  }
+
+  // Thickness map of every input instead of haunch detection, written as CSV.
+  int runThickness(const BatchOptions& options)
+  {
+    std::vector<ThicknessMap> maps;
+    for (const std::string& path : options.inputs)
+    {
+      TopoDS_Shape shape;
+      if (!ReadModel(path, shape))
+      {
+        std::cerr << "Failed to read model: " << path << "\n";
+        return EXIT_FAILURE;
+      }
+      const auto index = std::make_shared<const FaceIndex>(shape);
+      maps.push_back(ComputeThicknessMap(index, options.params.max_distance, options.params.angular_tol));
+      std::cout << path << ": " << maps.back().faces.size() << " faces with an opposite face, thickness "
+                << maps.back().min << " to " << maps.back().max << "\n";
+    }
+
+    if (!WriteThicknessCsv(options.thickness_path.c_str(), maps))
+    {
+      std::cerr << "Failed to write " << options.thickness_path << "\n";
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  // Snapshots of a result into <snapshot_dir>/<model name>_<view>.png.
+  //
+  // The renderer is created on the first call of each process and then reused: pool workers are forked
+  // before any of them renders, so every worker gets an OpenGL context of its own and none is shared.
+  bool writeSnapshots(const std::string& path, const BatchOptions& options, const HaunchResult& result)
+  {
+    static std::unique_ptr<SnapshotRenderer> renderer;
+    if (!renderer) { renderer = std::make_unique<SnapshotRenderer>(options.snapshot_size); }
+
+    std::error_code error;
+    std::filesystem::create_directories(options.snapshot_dir, error);
+    const std::filesystem::path prefix =
+        std::filesystem::path(options.snapshot_dir) / std::filesystem::path(path).stem();
+    return renderer->render(result, options.snapshot_views, prefix.string());
+  }
+
+  // Reading the model and writing snapshots are not part of detect_ms.
+  bool detectFile(const std::string& path,
+                  const BatchOptions& options,
+                  HaunchResult& result,
+                  double* detect_ms = nullptr)
+  {
+    TopoDS_Shape shape;
+    if (!ReadModel(path, shape))
+    {
+      std::cerr << "Failed to read model: " << path << "\n";
+      return false;
+    }
+
+    const auto start   = std::chrono::steady_clock::now();
+    const auto elapsed = [&]() {
+      if (detect_ms != nullptr)
+      {
+        *detect_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+    };
+    if (!options.stream)
+    {
+      result = FindHaunches(shape, options.params);
+      elapsed();
+      GroupRibFeatures(result, options.params);
+      return options.snapshot_dir.empty() || writeSnapshots(path, options, result);
+    }
+
+    StreamOptions stream;
+    stream.params        = options.params;
+    stream.memory_budget = options.memory_budget;
+    stream.spill_dir     = options.spill_dir;
+    try
+    {
+      result = FindHaunchesStreaming(shape, stream);
+    }
+    catch (const std::exception& error)
+    {
+      std::cerr << path << ": " << error.what() << "\n";
+      return false;
+    }
+    elapsed();
+    GroupRibFeatures(result, options.params);
+    return true;
+  }
+
+  // Add the signature of every processed input to the part library, or with --similar query it instead.
+  bool useLibrary(const BatchOptions& options, const std::vector<HaunchResult>& results, const std::vector<bool>& ok)
+  {
+    PartLibrary library;
+    if (!library.load(options.library_path))
+    {
+      std::cerr << "Cannot read part library: " << options.library_path << "\n";
+      return false;
+    }
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+      if (!ok[i])
+        continue;
+      const PartSignature signature = ComputePartSignature(results[i]);
+      if (options.similar <= 0)
+      {
+        library.add(std::filesystem::absolute(options.inputs[i]).lexically_normal().string(), signature);
+        continue;
+      }
+      std::cout << options.inputs[i] << ": parts with the most similar rib layout of " << library.size() << "\n";
+      for (const SimilarPart& part : library.nearest(signature, static_cast<size_t>(options.similar)))
+      {
+        std::printf("  %10.4f  %s\n", part.distance, part.name.c_str());
+      }
+    }
+
+    if (options.similar <= 0 && !library.save(options.library_path))
+    {
+      std::cerr << "Failed to write " << options.library_path << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  // Regression checks of a single-input run: the pair count and the detection time.
+  bool meetsExpectations(const BatchOptions& options, const HaunchResult& result, double detect_ms)
+  {
+    bool ok = true;
+    if (options.expect_pairs >= 0 && static_cast<long long>(result.pairs.size()) != options.expect_pairs)
+    {
+      std::cerr << "Expected " << options.expect_pairs << " haunch face pairs, found " << result.pairs.size() << "\n";
+      ok = false;
+    }
+    if (options.time_budget_ms > 0.0 && detect_ms > options.time_budget_ms)
+    {
+      std::cerr << "Detection took " << detect_ms << " ms, over the budget of " << options.time_budget_ms << " ms\n";
+      ok = false;
+    }
+    return ok;
+  }
+} // namespace
+
+bool IsBatchInvocation(int argc, char** argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--batch") == 0) { return true; }
+  }
+  return false;
+}
+
+int RunBatch(int argc, char** argv)
+{
+  BatchOptions options;
+  if (!parseOptions(argc, argv, options) || (options.is_sweep() && options.uses_pool())
+      || (options.time_budget_ms > 0.0 && options.uses_pool())
+      || (!options.snapshot_dir.empty() && (options.stream || options.snapshot_size <= 0))
+      || (options.similar > 0 && options.library_path.empty()))
+  {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  if (options.check_threads > 0) { return runThreadCheck(options); }
+  if (options.check_pipeline) { return runPipelineCheck(options); }
+  if (!options.thickness_path.empty()) { return runThickness(options); }
+
+  if (options.is_sweep())
+  {
+    TopoDS_Shape shape;
+    if (!ReadModel(options.inputs.front(), shape))
+    {
+      std::cerr << "Failed to read model: " << options.inputs.front() << "\n";
+      return EXIT_FAILURE;
+    }
+    return runSweep(shape, options);
+  }
+
+  std::vector<HaunchResult> results;
+  std::vector<bool> processed;
+  int status = EXIT_SUCCESS;
+  if (options.uses_pool())
+  {
+    const BatchDetect detect = [&options](const std::string& path, HaunchResult& result) {
+      return detectFile(path, options, result);
+    };
+    size_t failed = 0;
+    for (BatchFileResult& outcome : RunBatchPool(options.inputs, detect, options.pool))
+    {
+      failed += outcome.ok ? 0 : 1;
+      processed.push_back(outcome.ok);
+      results.push_back(std::move(outcome.result));
+    }
+    std::cout << options.inputs.size() - failed << " of " << options.inputs.size() << " inputs processed\n";
+    if (failed > 0) { status = EXIT_FAILURE; }
+
+    size_t pairs = 0;
+    for (const HaunchResult& result : results) { pairs += result.pairs.size(); }
+    if (options.expect_pairs >= 0 && static_cast<long long>(pairs) != options.expect_pairs)
+    {
+      std::cerr << "Expected " << options.expect_pairs << " haunch face pairs over all inputs, found " << pairs << "\n";
+      status = EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    double detect_ms = 0.0;
+    results.emplace_back();
+    if (!detectFile(options.inputs.front(), options, results.back(), &detect_ms)) { return EXIT_FAILURE; }
+    processed.push_back(true);
+    std::cout << options.inputs.front() << ": " << results.back().pairs.size() << " haunch face pairs in "
+              << detect_ms << " ms, " << results.back().features.size() << " rib features\n";
+    if (!meetsExpectations(options, results.back(), detect_ms)) { status = EXIT_FAILURE; }
+  }
+
+  if (!options.library_path.empty() && !useLibrary(options, results, processed)) { return EXIT_FAILURE; }
+  if (!options.export_path.empty() && !WriteHaunchResults(options.export_path.c_str(), results))
+  {
+    std::cerr << "Failed to write " << options.export_path << "\n";
+    return EXIT_FAILURE;
+  }
+  if (!options.json_path.empty() && !WriteHaunchResultsJson(options.json_path.c_str(), results))
+  {
+    std::cerr << "Failed to write " << options.json_path << "\n";
+    return EXIT_FAILURE;
+  }
+  return status;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Headless entry point used when RD is started with --batch:
+//
+//   RD --batch <model.brep|.step|.iges>... [--max-distance <d>] [--lateral-tol <t>] [--offset-tol <t>]
+//              [--angular-tol <rad>] [--min-overlap <ratio>] [--export <out.rdr>] [--json <out.json>]
+//
+// Giving any of --sweep-distances, --sweep-lateral or --sweep-angular (comma separated lists) switches to
+// the sweep mode, which prints the hit count of every combination instead of exporting results.
+// An axis without a list uses the single value of the corresponding option. --offset-tol, --min-overlap and
+// --min-area-ratio apply to every combination; angular tolerances above 1e-3 rad (FaceIndex::NORMAL_CELL)
+// are rejected, as is an --angular-tol above that value for any mode.
+//
+// --stream runs the detection with FindHaunchesStreaming, keeping at most --memory-budget megabytes of face
+// features in memory (256 by default) and spilling the rest to --spill-dir. The budget bounds the pair search
+// only; the model is still read whole before it is summarised.
+//
+// Several inputs (on the command line or one path per line of --input-list), --jobs or --checkpoint run the
+// files on RunBatchPool worker processes. The export then holds one shape per input, in input order, and
+// the exit code reports whether any input failed.
+//
+// --threads sets the threads of the pair search. --check-threads <n> instead runs every input with one and
+// with n threads and fails unless the exports are byte-identical. --check-pipeline likewise compares the
+// predicate pipeline picked for the options with the reference matcher, printing the time of both; with
+// --max-slowdown <ratio> it also fails when the pipeline takes longer than ratio times the reference, a
+// baseline measured in the same run on the same machine.
+// --min-area-ratio rejects pairs whose faces differ more in area (see HaunchParams).
+//
+// --thickness <out.csv> writes the wall thickness of every planar face (see ComputeThicknessMap) instead of
+// detecting haunches.
+//
+// --snapshots <dir> renders every input offscreen with its haunch faces in red and writes
+// <dir>/<model name>_<view>.png for each of the --snapshot-views presets (iso, front, top, right; iso by
+// default) at --snapshot-size pixels (512). It needs a display, e.g. xvfb-run, and cannot be combined with
+// --stream, which does not keep the shape.
+//
+// --library <parts.rdl> adds the rib layout signature of every input to a local part library (see
+// PartLibrary), keyed by the absolute model path. With --similar <k> the library is only queried, printing
+// the k parts closest to each input.
+//
+// For regression runs on a single input, --expect-pairs (or --truth with a file written by rd_generate) and
+// --time-budget make the exit code fail when the pair count differs or detection takes longer than allowed.
+// On the worker pool --expect-pairs is the total over all inputs; --time-budget needs a single input.
+//
+// Returns the process exit code.
+int RunBatch(int argc, char** argv);
+
+// True when the command line asks for the batch mode instead of the interactive viewer.
+bool IsBatchInvocation(int argc, char** argv);
@@ -0,0 +1,523 @@
+#include "batch_pool.h"
+#include "rib_features.h"
+
+#include <Standard_Failure.hxx>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  // Pair as sent from a worker and stored in the checkpoint, at full precision.
+  struct PairRecord
+  {
+    int32_t face1;
+    int32_t face2;
+    double thickness;
+    double normal[3];
+    double area1;
+    double area2;
+    int32_t feature;
+  };
+
+  // Rib feature as sent from a worker and stored in the checkpoint. Its pairs and faces are restored from
+  // the feature of every pair by LinkRibFeatures.
+  struct FeatureRecord
+  {
+    double thickness;
+    double length;
+    double height;
+    double normal[3];
+    double box[6]; // min and max corner, min above max for a void box
+  };
+
+  PairRecord toRecord(const HaunchPair& pair)
+  {
+    return { pair.face1,
+             pair.face2,
+             pair.thickness,
+             { pair.normal.X(), pair.normal.Y(), pair.normal.Z() },
+             pair.area1,
+             pair.area2,
+             pair.feature };
+  }
+
+  HaunchPair fromRecord(const PairRecord& record)
+  {
+    return { record.face1,
+             record.face2,
+             record.thickness,
+             gp_Dir(record.normal[0], record.normal[1], record.normal[2]),
+             record.area1,
+             record.area2,
+             record.feature };
+  }
+
+  FeatureRecord toRecord(const RibFeature& feature)
+  {
+    FeatureRecord record { feature.thickness,
+                           feature.length,
+                           feature.height,
+                           { feature.normal.X(), feature.normal.Y(), feature.normal.Z() },
+                           { 1.0, 1.0, 1.0, 0.0, 0.0, 0.0 } };
+    if (!feature.box.IsVoid())
+    {
+      feature.box.Get(record.box[0], record.box[1], record.box[2], record.box[3], record.box[4], record.box[5]);
+    }
+    return record;
+  }
+
+  RibFeature fromRecord(const FeatureRecord& record)
+  {
+    RibFeature feature;
+    feature.thickness = record.thickness;
+    feature.length    = record.length;
+    feature.height    = record.height;
+    feature.normal    = gp_Dir(record.normal[0], record.normal[1], record.normal[2]);
+    if (record.box[0] <= record.box[3])
+    {
+      feature.box.Update(record.box[0], record.box[1], record.box[2], record.box[3], record.box[4], record.box[5]);
+    }
+    return feature;
+  }
+
+  bool runDetect(const BatchDetect& detect, const std::string& path, HaunchResult& result)
+  {
+    try
+    {
+      return detect(path, result);
+    }
+    catch (const Standard_Failure& failure)
+    {
+      std::cerr << path << ": " << failure.GetMessageString() << "\n";
+    }
+    catch (const std::exception& error)
+    {
+      std::cerr << path << ": " << error.what() << "\n";
+    }
+    return false;
+  }
+
+  // Checkpoint format, one entry per finished input:
+  //
+  //   done <face_count> <pair_count> <path>
+  //   <face1> <face2> <thickness> <nx> <ny> <nz> <area1> <area2> <feature>   (pair_count lines)
+  //   feature <thickness> <length> <height> <nx> <ny> <nz> <box min xyz> <box max xyz>   (one per rib feature)
+  //   failed <path>
+  //
+  // A truncated last entry, left by an interrupted run, is ignored. Failed inputs are retried on resume.
+  // Checkpoints written before rib features existed lack the feature column and lines; their results are
+  // restored without features.
+  std::unordered_map<std::string, HaunchResult> loadCheckpoint(const std::string& path)
+  {
+    std::unordered_map<std::string, HaunchResult> finished;
+    HaunchResult* last = nullptr; // entry the following feature lines belong to
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+      std::istringstream entry(line);
+      std::string kind;
+      if (!(entry >> kind))
+        continue;
+      if (kind == "feature")
+      {
+        FeatureRecord record {};
+        entry >> record.thickness >> record.length >> record.height >> record.normal[0] >> record.normal[1]
+            >> record.normal[2];
+        for (double& coord : record.box) { entry >> coord; }
+        if (entry && last != nullptr) { last->features.push_back(fromRecord(record)); }
+        continue;
+      }
+
+      last              = nullptr;
+      int face_count    = 0;
+      size_t pair_count = 0;
+      if (kind != "done" || !(entry >> face_count >> pair_count))
+        continue;
+
+      std::string input;
+      entry.get();
+      std::getline(entry, input);
+
+      HaunchResult result;
+      result.face_count = face_count;
+      for (size_t i = 0; i < pair_count && std::getline(in, line); ++i)
+      {
+        PairRecord record {};
+        std::istringstream fields(line);
+        fields >> record.face1 >> record.face2 >> record.thickness >> record.normal[0] >> record.normal[1]
+            >> record.normal[2] >> record.area1 >> record.area2;
+        if (!fields)
+          break;
+        if (!(fields >> record.feature)) { record.feature = -1; }
+        result.pairs.push_back(fromRecord(record));
+      }
+      if (result.pairs.size() == pair_count)
+      {
+        last  = &finished[input];
+        *last = std::move(result);
+      }
+    }
+
+    // An entry cut off inside its feature lines names features it does not have
+    for (auto it = finished.begin(); it != finished.end();)
+    {
+      HaunchResult& result = it->second;
+      const bool complete  = std::all_of(result.pairs.begin(), result.pairs.end(), [&](const HaunchPair& pair) {
+        return pair.feature < static_cast<int>(result.features.size());
+      });
+      if (!complete)
+      {
+        it = finished.erase(it);
+        continue;
+      }
+      LinkRibFeatures(result);
+      ++it;
+    }
+    return finished;
+  }
+
+  void appendCheckpoint(FILE* out, const BatchFileResult& outcome)
+  {
+    if (out == nullptr)
+      return;
+    if (!outcome.ok)
+    {
+      std::fprintf(out, "failed %s\n", outcome.path.c_str());
+    }
+    else
+    {
+      std::fprintf(out,
+                   "done %d %zu %s\n",
+                   outcome.result.face_count,
+                   outcome.result.pairs.size(),
+                   outcome.path.c_str());
+      for (const HaunchPair& pair : outcome.result.pairs)
+      {
+        const PairRecord r = toRecord(pair);
+        std::fprintf(out,
+                     "%d %d %.17g %.17g %.17g %.17g %.17g %.17g %d\n",
+                     r.face1,
+                     r.face2,
+                     r.thickness,
+                     r.normal[0],
+                     r.normal[1],
+                     r.normal[2],
+                     r.area1,
+                     r.area2,
+                     r.feature);
+      }
+      for (const RibFeature& feature : outcome.result.features)
+      {
+        const FeatureRecord r = toRecord(feature);
+        std::fprintf(out, "feature %.17g %.17g %.17g", r.thickness, r.length, r.height);
+        for (const double value : r.normal) { std::fprintf(out, " %.17g", value); }
+        for (const double value : r.box) { std::fprintf(out, " %.17g", value); }
+        std::fprintf(out, "\n");
+      }
+    }
+    std::fflush(out);
+  }
+
+#ifndef _WIN32
+  // Reply of a worker to every task, followed by pair_count PairRecord and feature_count FeatureRecord.
+  struct TaskReply
+  {
+    uint32_t task;
+    uint32_t ok;
+    int32_t face_count;
+    uint32_t pair_count;
+    uint32_t feature_count;
+  };
+
+  struct Worker
+  {
+    pid_t pid    = -1;
+    int task_fd  = -1; // coordinator to worker, closed once the queue is drained
+    int reply_fd = -1; // worker to coordinator
+    int task     = -1; // input being processed, -1 when idle
+  };
+
+  bool readAll(int fd, void* data, size_t size)
+  {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0)
+    {
+      const ssize_t n = ::read(fd, bytes, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      bytes += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  bool writeAll(int fd, const void* data, size_t size)
+  {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+      const ssize_t n = ::write(fd, bytes, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      bytes += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  [[noreturn]] void workerMain(int task_fd,
+                               int reply_fd,
+                               const std::vector<std::string>& inputs,
+                               const BatchDetect& detect)
+  {
+    uint32_t task = 0;
+    std::vector<PairRecord> records;
+    std::vector<FeatureRecord> feature_records;
+    while (readAll(task_fd, &task, sizeof(task)))
+    {
+      HaunchResult result;
+      const bool ok = runDetect(detect, inputs[task], result);
+
+      records.clear();
+      feature_records.clear();
+      if (ok)
+      {
+        for (const HaunchPair& pair : result.pairs) { records.push_back(toRecord(pair)); }
+        for (const RibFeature& feature : result.features) { feature_records.push_back(toRecord(feature)); }
+      }
+      const TaskReply reply { task,
+                              ok ? 1u : 0u,
+                              result.face_count,
+                              static_cast<uint32_t>(records.size()),
+                              static_cast<uint32_t>(feature_records.size()) };
+      if (!writeAll(reply_fd, &reply, sizeof(reply)) ||
+          !writeAll(reply_fd, records.data(), records.size() * sizeof(PairRecord)) ||
+          !writeAll(reply_fd, feature_records.data(), feature_records.size() * sizeof(FeatureRecord)))
+        break;
+    }
+    // Skip atexit handlers and static destructors, which belong to the coordinator
+    _exit(EXIT_SUCCESS);
+  }
+
+  void closeFd(int& fd)
+  {
+    if (fd >= 0) { ::close(fd); }
+    fd = -1;
+  }
+
+  bool spawn(Worker& worker,
+             std::vector<Worker>& workers,
+             const std::vector<std::string>& inputs,
+             const BatchDetect& detect)
+  {
+    int task_pipe[2];
+    int reply_pipe[2];
+    if (::pipe(task_pipe) != 0)
+      return false;
+    if (::pipe(reply_pipe) != 0)
+    {
+      ::close(task_pipe[0]);
+      ::close(task_pipe[1]);
+      return false;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    const pid_t pid = ::fork();
+    if (pid == 0)
+    {
+      // Other workers must see end of file on their task pipe when the coordinator closes it
+      for (Worker& other : workers)
+      {
+        closeFd(other.task_fd);
+        closeFd(other.reply_fd);
+      }
+      ::close(task_pipe[1]);
+      ::close(reply_pipe[0]);
+      workerMain(task_pipe[0], reply_pipe[1], inputs, detect);
+    }
+
+    ::close(task_pipe[0]);
+    ::close(reply_pipe[1]);
+    if (pid < 0)
+    {
+      ::close(task_pipe[1]);
+      ::close(reply_pipe[0]);
+      return false;
+    }
+    worker.pid      = pid;
+    worker.task_fd  = task_pipe[1];
+    worker.reply_fd = reply_pipe[0];
+    worker.task     = -1;
+    return true;
+  }
+#endif
+} // namespace
+
+std::vector<BatchFileResult> RunBatchPool(const std::vector<std::string>& inputs,
+                                          const BatchDetect& detect,
+                                          const BatchPoolOptions& options)
+{
+  std::vector<BatchFileResult> outcomes(inputs.size());
+  std::deque<int> queue;
+
+  std::unordered_map<std::string, HaunchResult> finished;
+  if (!options.checkpoint.empty()) { finished = loadCheckpoint(options.checkpoint); }
+  for (size_t i = 0; i < inputs.size(); ++i)
+  {
+    outcomes[i].path = inputs[i];
+    auto it          = finished.find(inputs[i]);
+    if (it != finished.end())
+    {
+      outcomes[i].ok     = true;
+      outcomes[i].result = it->second;
+    }
+    else { queue.push_back(static_cast<int>(i)); }
+  }
+  if (!finished.empty())
+  {
+    std::cout << inputs.size() - queue.size() << " inputs restored from " << options.checkpoint << "\n";
+  }
+
+  FILE* checkpoint = options.checkpoint.empty() ? nullptr : std::fopen(options.checkpoint.c_str(), "a");
+  const auto finish = [&](int task, bool ok, HaunchResult result) {
+    BatchFileResult& outcome = outcomes[task];
+    outcome.ok               = ok;
+    outcome.result           = std::move(result);
+    appendCheckpoint(checkpoint, outcome);
+    if (ok)
+    {
+      std::cout << outcome.path << ": " << outcome.result.pairs.size() << " haunch face pairs, "
+                << outcome.result.features.size() << " rib features\n";
+    }
+    else { std::cerr << outcome.path << ": failed\n"; }
+  };
+
+#ifdef _WIN32
+  for (int task : queue)
+  {
+    HaunchResult result;
+    const bool ok = runDetect(detect, inputs[task], result);
+    finish(task, ok, std::move(result));
+  }
+#else
+  // A write to the pipe of a worker that just died must fail instead of killing the coordinator
+  ::signal(SIGPIPE, SIG_IGN);
+
+  std::vector<int> attempts(inputs.size(), 0);
+  std::vector<Worker> workers(std::min<size_t>(std::max(options.jobs, 1), queue.size()));
+
+  const auto dispatch = [&](Worker& worker) {
+    if (queue.empty())
+    {
+      closeFd(worker.task_fd);
+      return;
+    }
+    worker.task = queue.front();
+    queue.pop_front();
+    const uint32_t task = static_cast<uint32_t>(worker.task);
+    // On failure the worker is gone, which shows up as end of file on its reply pipe
+    writeAll(worker.task_fd, &task, sizeof(task));
+  };
+
+  for (Worker& worker : workers)
+  {
+    if (spawn(worker, workers, inputs, detect)) { dispatch(worker); }
+  }
+
+  std::vector<pollfd> fds;
+  std::vector<Worker*> polled;
+  std::vector<PairRecord> records;
+  std::vector<FeatureRecord> feature_records;
+  for (;;)
+  {
+    fds.clear();
+    polled.clear();
+    for (Worker& worker : workers)
+    {
+      if (worker.pid < 0)
+        continue;
+      fds.push_back({ worker.reply_fd, POLLIN, 0 });
+      polled.push_back(&worker);
+    }
+    if (fds.empty())
+      break;
+    if (::poll(fds.data(), fds.size(), -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    for (size_t i = 0; i < fds.size(); ++i)
+    {
+      if (fds[i].revents == 0)
+        continue;
+      Worker& worker = *polled[i];
+
+      TaskReply reply {};
+      if (readAll(worker.reply_fd, &reply, sizeof(reply)))
+      {
+        records.resize(reply.pair_count);
+        feature_records.resize(reply.feature_count);
+        if (readAll(worker.reply_fd, records.data(), records.size() * sizeof(PairRecord)) &&
+            readAll(worker.reply_fd, feature_records.data(), feature_records.size() * sizeof(FeatureRecord)))
+        {
+          HaunchResult result;
+          result.face_count = reply.face_count;
+          for (const PairRecord& record : records) { result.pairs.push_back(fromRecord(record)); }
+          for (const FeatureRecord& record : feature_records) { result.features.push_back(fromRecord(record)); }
+          LinkRibFeatures(result);
+          finish(static_cast<int>(reply.task), reply.ok != 0, std::move(result));
+          worker.task = -1;
+          dispatch(worker);
+          continue;
+        }
+      }
+
+      // End of file: the worker exited after its task pipe was closed, or crashed
+      closeFd(worker.task_fd);
+      closeFd(worker.reply_fd);
+      int status = 0;
+      ::waitpid(worker.pid, &status, 0);
+      worker.pid = -1;
+      if (worker.task >= 0)
+      {
+        const int task = worker.task;
+        worker.task    = -1;
+        std::cerr << inputs[task] << ": worker " << (WIFSIGNALED(status) ? "killed by signal " : "exited with ")
+                  << (WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status)) << "\n";
+        if (++attempts[task] < options.max_attempts) { queue.push_front(task); }
+        else { finish(task, false, HaunchResult()); }
+      }
+      if (!queue.empty() && spawn(worker, workers, inputs, detect)) { dispatch(worker); }
+    }
+  }
+
+  // Inputs left over when workers could not be started at all
+  for (int task : queue) { finish(task, false, HaunchResult()); }
+#endif
+
+  if (checkpoint != nullptr) { std::fclose(checkpoint); }
+  return outcomes;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "haunch.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Outcome of one input of a batch run. Only the face count and the pairs of the result are filled in.
+struct BatchFileResult
+{
+  std::string path;
+  bool ok = false;
+  HaunchResult result;
+};
+
+struct BatchPoolOptions
+{
+  int jobs         = 1; // worker processes
+  int max_attempts = 2; // a file taking down its worker this many times is reported as failed
+  std::string checkpoint; // file recording finished inputs so that an interrupted run can resume, empty for none
+};
+
+// Detection of one input file, run inside a worker process. Returns false when the file cannot be processed.
+using BatchDetect = std::function<bool(const std::string& path, HaunchResult& result)>;
+
+// Run `detect` over every input on a pool of forked worker processes, each with its own OCCT heap.
+//
+// The coordinator hands out one file at a time per worker through a pipe and reads the pairs back through
+// another. A worker that dies, e.g. on an OCCT abort, is restarted and its file queued again. Finished files
+// are appended to the checkpoint; inputs already recorded there are not processed again.
+// Outcomes are returned in input order. Without fork() the inputs are processed sequentially in-process.
+std::vector<BatchFileResult> RunBatchPool(const std::vector<std::string>& inputs,
+                                          const BatchDetect& detect,
+                                          const BatchPoolOptions& options);
@@ -0,0 +1,123 @@
+#include "face_diff.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+namespace
+{
+  using Signature = std::vector<int64_t>;
+
+  struct SignatureHash
+  {
+    size_t operator()(const Signature& signature) const
+    {
+      uint64_t hash = 1469598103934665603ull; // FNV-1a over the quantised values
+      for (const int64_t value : signature)
+      {
+        hash ^= static_cast<uint64_t>(value);
+        hash *= 1099511628211ull;
+      }
+      return static_cast<size_t>(hash);
+    }
+  };
+
+  int64_t quantise(double value) { return std::llround(value / FaceDiff::SIGNATURE_CELL); }
+
+  // Plane (normal and offset), sorted vertices and the square root of the area, which is a length like the rest.
+  Signature signatureOf(const FaceIndex& index, const FaceFeature& feature)
+  {
+    Signature signature;
+    signature.reserve(6 + 3 * feature.vertices.size());
+    const gp_XYZ normal = feature.normal.XYZ();
+    signature.push_back(quantise(normal.X()));
+    signature.push_back(quantise(normal.Y()));
+    signature.push_back(quantise(normal.Z()));
+    signature.push_back(quantise(normal.Dot(feature.centroid.XYZ())));
+
+    std::vector<std::array<int64_t, 3>> vertices;
+    vertices.reserve(feature.vertices.size());
+    for (const gp_Pnt& vertex : feature.vertices)
+    {
+      vertices.push_back({ quantise(vertex.X()), quantise(vertex.Y()), quantise(vertex.Z()) });
+    }
+    std::sort(vertices.begin(), vertices.end());
+    for (const auto& vertex : vertices) { signature.insert(signature.end(), vertex.begin(), vertex.end()); }
+
+    const double area = feature.area >= 0.0 ? feature.area : FaceArea(index.face(feature.id));
+    signature.push_back(quantise(std::sqrt(std::max(0.0, area))));
+    return signature;
+  }
+} // namespace
+
+FaceDiff DiffFaces(const FaceIndex& before, const FaceIndex& after)
+{
+  Profiler::Scope timer("face diff");
+  FaceDiff diff;
+  diff.old_of.assign(after.face_count() + 1, 0);
+
+  // An index without a shape has no areas to compare, every face then counts as changed
+  std::unordered_map<Signature, std::vector<int>, SignatureHash> old_ids;
+  if (!before.faces().IsEmpty())
+  {
+    for (const FaceFeature& feature : before.features())
+    {
+      old_ids[signatureOf(before, feature)].push_back(feature.id);
+    }
+  }
+
+  size_t matched = 0;
+  for (const FaceFeature& feature : after.features())
+  {
+    auto it = old_ids.end();
+    if (!old_ids.empty() && !after.faces().IsEmpty()) { it = old_ids.find(signatureOf(after, feature)); }
+    if (it == old_ids.end() || it->second.empty())
+    {
+      diff.changed.push_back(feature.id);
+      continue;
+    }
+    // Identical faces are handed out in id order, either assignment gives the same pairs
+    diff.old_of[feature.id] = it->second.front();
+    it->second.erase(it->second.begin());
+    ++matched;
+  }
+  std::sort(diff.changed.begin(), diff.changed.end());
+  diff.removed = static_cast<int>(before.features().size() - matched);
+  return diff;
+}
+
+HaunchResult UpdateHaunches(const HaunchResult& before,
+                            const std::shared_ptr<const FaceIndex>& after,
+                            const FaceDiff& diff,
+                            const HaunchParams& params)
+{
+  HaunchResult result = FindHaunchesForFaces(after, diff.changed, params);
+
+  int old_count = before.face_count;
+  for (const HaunchPair& pair : before.pairs) { old_count = std::max({ old_count, pair.face1, pair.face2 }); }
+  std::vector<int> new_of(old_count + 1, 0);
+  for (size_t id = 1; id < diff.old_of.size(); ++id)
+  {
+    if (diff.old_of[id] > 0 && diff.old_of[id] <= old_count) { new_of[diff.old_of[id]] = static_cast<int>(id); }
+  }
+
+  // A pair with a changed face was tested again above and is only kept if it still matches
+  for (const HaunchPair& pair : before.pairs)
+  {
+    const int face1 = new_of[pair.face1];
+    const int face2 = new_of[pair.face2];
+    if (face1 == 0 || face2 == 0)
+      continue;
+    HaunchPair kept = pair;
+    kept.face1      = std::min(face1, face2);
+    kept.face2      = std::max(face1, face2);
+    kept.feature    = -1;
+    if (face1 > face2) { std::swap(kept.area1, kept.area2); }
+    result.pairs.push_back(kept);
+  }
+
+  SortHaunchPairs(result.pairs);
+  return result;
+}
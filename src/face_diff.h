@@ -0,0 +1,34 @@
+#pragma once
+
+#include "face_index.h"
+#include "haunch.h"
+
+#include <memory>
+#include <vector>
+
+// Planar faces of a new version of a shape matched to the faces of the previous version.
+//
+// Faces are compared by a signature of their plane, their vertex set (in any order) and their area,
+// quantised to SIGNATURE_CELL, so matching does not depend on face ids, which change with every export.
+// A face whose geometry moved by more than the cell is reported as changed even though it may still
+// pair the same way; that only costs a pair test, never a stale pair.
+struct FaceDiff
+{
+  static constexpr double SIGNATURE_CELL = 1e-6;
+
+  std::vector<int> old_of;  // per face id of the new version, the matching old id or 0; index 0 is unused
+  std::vector<int> changed; // planar faces of the new version without a match, sorted
+  int removed = 0;          // planar faces of the old version without a match
+};
+
+FaceDiff DiffFaces(const FaceIndex& before, const FaceIndex& after);
+
+// Detection result for the shape of `after`, computed from the result of the previous version.
+//
+// Pairs of two unchanged faces are carried over with their ids renumbered; only the changed faces are
+// tested again, against every face of the new version. The result equals FindHaunches(after, params) as
+// long as `before` was found with the same params. Rib features are not grouped.
+HaunchResult UpdateHaunches(const HaunchResult& before,
+                            const std::shared_ptr<const FaceIndex>& after,
+                            const FaceDiff& diff,
+                            const HaunchParams& params);
@@ -0,0 +1,206 @@
+#include "face_index.h"
+#include "haunch.h"
+#include "overlap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+  // Largest distance of a vertex or outline point from the centroid: every point of the face lies within it.
+  double faceRadius(const FaceFeature& feature)
+  {
+    double radius = 0.0;
+    for (const gp_Pnt& point : feature.vertices) { radius = std::max(radius, point.Distance(feature.centroid)); }
+    for (const gp_Pnt& point : feature.outline) { radius = std::max(radius, point.Distance(feature.centroid)); }
+    return radius;
+  }
+} // namespace
+
+bool MakeFaceFeature(const TopoDS_Face& face, int id, FaceFeature& feature, bool with_outline)
+{
+  gp_Dir normal;
+  if (!GetFacePlaneNormal(face, normal))
+    return false;
+
+  feature.id     = id;
+  feature.normal = FaceIndex::canonical(normal);
+  feature.vertices.clear();
+
+  TopTools_IndexedMapOfShape verts;
+  TopExp::MapShapes(face, TopAbs_VERTEX, verts);
+  gp_XYZ sum(0.0, 0.0, 0.0);
+  feature.vertices.reserve(verts.Extent());
+  for (int i = 1; i <= verts.Extent(); ++i)
+  {
+    feature.vertices.push_back(BRep_Tool::Pnt(TopoDS::Vertex(verts(i))));
+    sum += feature.vertices.back().XYZ();
+  }
+  if (feature.vertices.empty())
+    return false;
+
+  feature.centroid = gp_Pnt(sum / static_cast<double>(feature.vertices.size()));
+  feature.outline.clear();
+  if (with_outline) { feature.outline = FaceOutline(face); }
+  return true;
+}
+
+FaceIndex::FaceIndex(const TopoDS_Shape& shape, bool with_outlines) :
+    m_shape(shape), m_with_outlines(with_outlines)
+{
+  TopExp::MapShapes(shape, TopAbs_FACE, m_faces);
+  m_feature_of.assign(m_faces.Extent() + 1, -1);
+
+  for (int id = 1; id <= m_faces.Extent(); ++id)
+  {
+    FaceFeature feature;
+    if (!MakeFaceFeature(TopoDS::Face(m_faces(id)), id, feature, with_outlines))
+      continue;
+
+    m_feature_of[id] = static_cast<int>(m_features.size());
+    m_features.push_back(std::move(feature));
+  }
+
+  build();
+}
+
+FaceIndex::FaceIndex(std::vector<FaceFeature> features, int face_count) :
+    m_features(std::move(features))
+{
+  m_feature_of.assign(face_count + 1, -1);
+  for (int i = 0; i < static_cast<int>(m_features.size()); ++i) { m_feature_of[m_features[i].id] = i; }
+
+  build();
+}
+
+void FaceIndex::build()
+{
+  for (int i = 0; i < static_cast<int>(m_features.size()); ++i)
+  {
+    const FaceFeature& feature = m_features[i];
+    auto [it, inserted]        = m_bucket_of_key.emplace(key(feature.normal), static_cast<int>(m_buckets.size()));
+    if (inserted) { m_buckets.push_back({ feature.normal, {}, {} }); }
+    Bucket& bucket = m_buckets[it->second];
+    bucket.features.push_back(i);
+    bucket.radius = std::max(bucket.radius, faceRadius(feature));
+  }
+
+  for (Bucket& bucket : m_buckets)
+  {
+    const gp_XYZ axis = bucket.normal.XYZ();
+    std::vector<double> offsets(bucket.features.size());
+    for (size_t i = 0; i < offsets.size(); ++i)
+    {
+      offsets[i] = axis.Dot(m_features[bucket.features[i]].centroid.XYZ());
+    }
+
+    std::vector<size_t> order(offsets.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+
+    std::vector<int> features(order.size());
+    bucket.offsets.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+      bucket.offsets[i] = offsets[order[i]];
+      features[i]       = bucket.features[order[i]];
+    }
+    bucket.features = std::move(features);
+  }
+}
+
+size_t FaceIndex::memory_bytes() const
+{
+  size_t bytes = sizeof(*this) + m_features.capacity() * sizeof(FaceFeature) + m_feature_of.capacity() * sizeof(int)
+               + m_buckets.capacity() * sizeof(Bucket);
+  for (const FaceFeature& feature : m_features)
+  {
+    bytes += (feature.vertices.capacity() + feature.outline.capacity()) * sizeof(gp_Pnt);
+  }
+  for (const Bucket& bucket : m_buckets)
+  {
+    bytes += bucket.offsets.capacity() * sizeof(double) + bucket.features.capacity() * sizeof(int);
+  }
+  // Hash nodes of the bucket lookup and of the face map, roughly a few pointers each
+  bytes += m_bucket_of_key.size() * (sizeof(std::pair<const uint64_t, int>) + 2 * sizeof(void*))
+         + m_bucket_of_key.bucket_count() * sizeof(void*);
+  bytes += static_cast<size_t>(m_faces.Extent()) * (sizeof(TopoDS_Shape) + 4 * sizeof(void*));
+  return bytes;
+}
+
+const TopoDS_Face& FaceIndex::face(int id) const { return TopoDS::Face(m_faces(id)); }
+
+void FaceIndex::partners(int feature, double max_distance, std::vector<int>& out) const
+{
+  const FaceFeature& query = m_features[feature];
+  // Offsets are measured along a bucket normal instead of the query normal. Both lie in the same or adjacent
+  // cells, so they differ by less than two cells per component, and the offset of a candidate shifts by up to
+  // that tilt times its distance from the query centroid. For a partner within max_distance whose face
+  // overlaps the query face, that distance is at most max_distance plus both face radii; when only the
+  // bounding boxes in the query plane overlap, as for ComputeThicknessMap, the lateral part grows by sqrt(2).
+  const double tilt         = 2.0 * std::sqrt(3.0) * NORMAL_CELL;
+  const double query_radius = faceRadius(query);
+
+  int visited[54];
+  int visited_count = 0;
+
+  // A normal close to a tie between its largest components may have been canonicalised the other way round,
+  // so the neighbourhood of the opposite direction is searched as well.
+  for (const gp_Dir& dir : { query.normal, query.normal.Reversed() })
+  {
+    const int64_t cx = cell(dir.X());
+    const int64_t cy = cell(dir.Y());
+    const int64_t cz = cell(dir.Z());
+    for (int64_t dx = -1; dx <= 1; ++dx)
+    {
+      for (int64_t dy = -1; dy <= 1; ++dy)
+      {
+        for (int64_t dz = -1; dz <= 1; ++dz)
+        {
+          auto it = m_bucket_of_key.find(key(cx + dx, cy + dy, cz + dz));
+          if (it == m_bucket_of_key.end())
+            continue;
+          if (std::find(visited, visited + visited_count, it->second) != visited + visited_count)
+            continue;
+          visited[visited_count++] = it->second;
+
+          const Bucket& bucket = m_buckets[it->second];
+          const double center  = bucket.normal.XYZ().Dot(query.centroid.XYZ());
+          const double lateral = M_SQRT2 * (query_radius + bucket.radius);
+          const double slack   = tilt * (max_distance + lateral) + Precision::Confusion();
+          const double reach   = max_distance + slack;
+          auto first           = std::lower_bound(bucket.offsets.begin(), bucket.offsets.end(), center - reach);
+          auto last            = std::upper_bound(first, bucket.offsets.end(), center + reach);
+          for (auto o = first; o != last; ++o)
+          {
+            const int candidate = bucket.features[o - bucket.offsets.begin()];
+            if (candidate != feature) { out.push_back(candidate); }
+          }
+        }
+      }
+    }
+  }
+}
+
+gp_Dir FaceIndex::canonical(const gp_Dir& normal)
+{
+  const double ax = std::abs(normal.X());
+  const double ay = std::abs(normal.Y());
+  const double az = std::abs(normal.Z());
+  double major    = normal.Z();
+  if (ax >= ay && ax >= az) { major = normal.X(); }
+  else if (ay >= az) { major = normal.Y(); }
+  return major < 0.0 ? normal.Reversed() : normal;
+}
+
+int64_t FaceIndex::cell(double value) { return static_cast<int64_t>(std::floor(value / NORMAL_CELL)); }
+
+uint64_t FaceIndex::key(int64_t x, int64_t y, int64_t z)
+{
+  // Components are within [-1, 1], so every cell coordinate fits comfortably in 21 bits once biased
+  const int64_t bias = int64_t(1) << 20;
+  return (uint64_t(x + bias) << 42) | (uint64_t(y + bias) << 21) | uint64_t(z + bias);
+}
+
+uint64_t FaceIndex::key(const gp_Dir& normal) { return key(cell(normal.X()), cell(normal.Y()), cell(normal.Z())); }
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS_Face.hxx>
+#include <TopoDS_Shape.hxx>
+#include <gp_Dir.hxx>
+#include <gp_Pnt.hxx>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Geometry of a planar face reduced to what the pair search needs.
+struct FaceFeature
+{
+  int id;        // 1-based index into TopExp::MapShapes(shape, TopAbs_FACE, ...)
+  gp_Dir normal; // plane normal, sign chosen so that parallel faces share the same direction
+  gp_Pnt centroid;
+  std::vector<gp_Pnt> vertices;
+  std::vector<gp_Pnt> outline; // ordered outer boundary (FaceOutline), only kept for the overlap matcher
+  double area = -1.0;          // negative until computed
+};
+
+// Summarise a face; returns false when it is not planar.
+bool MakeFaceFeature(const TopoDS_Face& face, int id, FaceFeature& feature, bool with_outline = false);
+
+// Spatial offset index over the planar faces of a shape.
+//
+// Faces are bucketed by their quantised normal direction, and inside a bucket sorted by the offset of
+// their centroid along the bucket normal. Partners of a face within a distance are then found with a
+// few hash lookups and a binary search instead of a scan over every face.
+class FaceIndex
+{
+ public:
+  // Normals closer than this (per component of the unit vector) always land in the same or adjacent bucket.
+  static constexpr double NORMAL_CELL = 1e-3;
+
+  explicit FaceIndex(const TopoDS_Shape& shape, bool with_outlines = false);
+
+  // Index over features summarised elsewhere. There is no shape behind it, so face() must not be used.
+  FaceIndex(std::vector<FaceFeature> features, int face_count);
+
+  const TopoDS_Shape& shape() const { return m_shape; }
+  const TopTools_IndexedMapOfShape& faces() const { return m_faces; }
+  const TopoDS_Face& face(int id) const;
+  int face_count() const { return static_cast<int>(m_feature_of.size()) - 1; }
+  bool has_outlines() const { return m_with_outlines; }
+
+  // Approximate heap use of the index, not counting the shape itself.
+  size_t memory_bytes() const;
+
+  const std::vector<FaceFeature>& features() const { return m_features; }
+
+  // Position of the face in features(), or -1 when the face is not planar.
+  int feature_of(int id) const { return m_feature_of[id]; }
+
+  // Feature positions of faces that may be parallel to `feature` and lie within `max_distance` of it.
+  // Candidates still have to be checked exactly; the feature itself is not reported.
+  void partners(int feature, double max_distance, std::vector<int>& out) const;
+
+  // Normal with the sign used for bucketing: the component of largest magnitude is positive.
+  static gp_Dir canonical(const gp_Dir& normal);
+
+ private:
+  struct Bucket
+  {
+    gp_Dir normal;
+    std::vector<double> offsets; // sorted
+    std::vector<int> features;   // parallel to offsets
+    double radius = 0.0;         // largest distance of a face's points from its centroid
+  };
+
+  void build();
+
+  static int64_t cell(double value);
+  static uint64_t key(int64_t x, int64_t y, int64_t z);
+  static uint64_t key(const gp_Dir& normal);
+
+  TopoDS_Shape m_shape;
+  TopTools_IndexedMapOfShape m_faces;
+  std::vector<FaceFeature> m_features;
+  std::vector<int> m_feature_of;
+  std::vector<Bucket> m_buckets;
+  std::unordered_map<uint64_t, int> m_bucket_of_key;
+  bool m_with_outlines = false;
+};
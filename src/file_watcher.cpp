@@ -0,0 +1,145 @@
+#include "file_watcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  std::filesystem::file_time_type writeTime(const std::filesystem::path& path)
+  {
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type::min() : time;
+  }
+} // namespace
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+  if (m_fd >= 0) { close(m_fd); }
+#endif
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+  if (watching(path)) { return; }
+
+  const std::filesystem::path absolute = std::filesystem::absolute(path).lexically_normal();
+  File file { absolute.parent_path(), absolute.filename(), writeTime(absolute), true };
+#ifdef __linux__
+  if (m_fd >= 0)
+  {
+    // Watching a directory twice returns the descriptor it already has
+    const int wd = inotify_add_watch(m_fd, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd >= 0)
+    {
+      m_directories[wd] = file.directory;
+      file.polled       = false;
+    }
+  }
+#endif
+  m_files.emplace(path, std::move(file));
+}
+
+void FileWatcher::unwatch(const std::string& path)
+{
+  const auto it = m_files.find(path);
+  if (it == m_files.end()) { return; }
+  const std::filesystem::path directory = it->second.directory;
+  m_files.erase(it);
+  m_pending.erase(path);
+
+#ifdef __linux__
+  for (const auto& [other, file] : m_files)
+  {
+    if (file.directory == directory) { return; }
+  }
+  for (auto dir = m_directories.begin(); dir != m_directories.end(); ++dir)
+  {
+    if (dir->second == directory)
+    {
+      inotify_rm_watch(m_fd, dir->first);
+      m_directories.erase(dir);
+      break;
+    }
+  }
+#endif
+}
+
+std::vector<std::string> FileWatcher::take_changed()
+{
+  const Clock::time_point now = Clock::now();
+  read_events(now);
+  if (now - m_last_poll >= POLL_INTERVAL)
+  {
+    poll_times(now);
+    m_last_poll = now;
+  }
+
+  std::vector<std::string> changed;
+  for (auto it = m_pending.begin(); it != m_pending.end();)
+  {
+    if (now - it->second < SETTLE_TIME)
+    {
+      ++it;
+      continue;
+    }
+    changed.push_back(it->first);
+    it = m_pending.erase(it);
+  }
+  return changed;
+}
+
+void FileWatcher::read_events(Clock::time_point now)
+{
+#ifdef __linux__
+  if (m_fd < 0) { return; }
+
+  alignas(inotify_event) char buffer[4096];
+  for (;;)
+  {
+    const ssize_t size = read(m_fd, buffer, sizeof(buffer));
+    if (size <= 0)
+      break;
+    for (ssize_t offset = 0; offset < size;)
+    {
+      const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+      offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      const auto dir = m_directories.find(event->wd);
+      if (dir == m_directories.end() || event->len == 0)
+        continue;
+      const std::filesystem::path name(event->name);
+      for (const auto& [path, file] : m_files)
+      {
+        if (file.directory == dir->second && file.name == name) { m_pending[path] = now; }
+      }
+    }
+  }
+#else
+  (void)now;
+#endif
+}
+
+void FileWatcher::poll_times(Clock::time_point now)
+{
+  for (auto& [path, file] : m_files)
+  {
+    if (!file.polled)
+      continue;
+    const auto time = writeTime(file.directory / file.name);
+    if (time != file.time)
+    {
+      file.time       = time;
+      m_pending[path] = now;
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+// Notices when watched model files are written again.
+//
+// On Linux the directories holding the files are watched with inotify: exporters often write a temporary
+// file and rename it over the old one, which a watch on the file itself would lose. A file counts as
+// written when it is closed after writing or renamed into place. Elsewhere modification times are
+// compared every POLL_INTERVAL. Either way a file is only reported once SETTLE_TIME has passed without
+// another event, so a save done in several steps causes a single reload.
+class FileWatcher
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::chrono::milliseconds SETTLE_TIME { 300 };
+  static constexpr std::chrono::milliseconds POLL_INTERVAL { 500 };
+
+  FileWatcher();
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&)            = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  void watch(const std::string& path);
+  void unwatch(const std::string& path);
+  bool watching(const std::string& path) const { return m_files.count(path) > 0; }
+
+  // Watched files written since the previous call, as passed to watch(). Does not block.
+  std::vector<std::string> take_changed();
+
+ private:
+  struct File
+  {
+    std::filesystem::path directory;
+    std::filesystem::path name;
+    std::filesystem::file_time_type time;
+    bool polled; // no inotify watch on the directory, the modification time is compared instead
+  };
+
+  void read_events(Clock::time_point now);
+  void poll_times(Clock::time_point now);
+
+  std::map<std::string, File> m_files;
+  std::map<std::string, Clock::time_point> m_pending; // last event of each written file
+  Clock::time_point m_last_poll;
+  int m_fd = -1;                                      // inotify instance, -1 when modification times are polled
+  std::map<int, std::filesystem::path> m_directories; // inotify watch descriptor to directory
+};
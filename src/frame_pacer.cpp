@@ -0,0 +1,48 @@
+#include "frame_pacer.h"
+#include "profiler.h"
+
+#include <thread>
+
+namespace
+{
+  // Sleeping is only accurate to about a millisecond on most systems, the rest of the wait is spent yielding
+  static constexpr std::chrono::microseconds SLEEP_SLACK(1000);
+  // Head start on the predicted work, so small variations do not miss the deadline
+  static constexpr std::chrono::microseconds WORK_MARGIN(500);
+  // Weight of the newest frame in the moving average of the work time
+  static constexpr double WORK_SMOOTHING = 0.1;
+
+  double elapsedMs(FramePacer::Clock::time_point from, FramePacer::Clock::time_point to)
+  {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+  }
+} // namespace
+
+void FramePacer::wait()
+{
+  if (m_target_fps > 0.0)
+  {
+    const auto work = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_work_ms));
+    const Clock::time_point wake = m_deadline - work - WORK_MARGIN;
+    if (wake - SLEEP_SLACK > Clock::now()) { std::this_thread::sleep_until(wake - SLEEP_SLACK); }
+    while (Clock::now() < wake) { std::this_thread::yield(); }
+  }
+  m_start = Clock::now();
+}
+
+void FramePacer::presented()
+{
+  const Clock::time_point now = Clock::now();
+  const double work_ms        = elapsedMs(m_start, now);
+  m_work_ms                   = m_work_ms == 0.0 ? work_ms : m_work_ms + WORK_SMOOTHING * (work_ms - m_work_ms);
+
+  Profiler::instance().record("frame work", work_ms);
+  if (m_last_present != Clock::time_point()) { Profiler::instance().record("frame", elapsedMs(m_last_present, now)); }
+  m_last_present = now;
+
+  if (m_target_fps <= 0.0) { return; }
+  const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_target_fps));
+  m_deadline += period;
+  // A frame that ran late starts a new schedule instead of rushing to catch up
+  if (m_deadline < now) { m_deadline = now + period; }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+
+// Paces the main loop to a target frame rate.
+//
+// wait() sleeps until the work of the next frame has to start for it to be presented on time, so input
+// sampled right after it is as fresh as the predicted frame time allows. The prediction is a moving
+// average of the time from wait() returning to presented(). Without a target the loop is not throttled.
+class FramePacer
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Frames per second, 0 for no cap.
+  void set_target_fps(double fps) { m_target_fps = fps; }
+  double target_fps() const { return m_target_fps; }
+
+  void wait();
+
+  // The frame begun by the last wait() was presented.
+  void presented();
+
+  double predicted_work_ms() const { return m_work_ms; }
+
+ private:
+  double m_target_fps = 60.0;
+  double m_work_ms    = 0.0;
+  Clock::time_point m_start;
+  Clock::time_point m_deadline;
+  Clock::time_point m_last_present;
+};
@@ -0,0 +1,170 @@
+#include "frame_readback.h"
+
+#include <OpenGl_Context.hxx>
+#include <OpenGl_FrameBuffer.hxx>
+#include <OpenGl_View.hxx>
+#include <OpenGl_Window.hxx>
+
+#include <cstring>
+
+namespace
+{
+  static constexpr int BYTES_PER_PIXEL = 3; // Image_Format_RGB, what the view texture is uploaded from
+  // The copy of the previous frame has had a whole frame to finish, waiting longer means the driver is stuck
+  static constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+  // Context of the view's own window. Framebuffers are not shared between contexts, so the slots have to be
+  // created, bound and read in the context FBOCreate made them in, not the driver's shared one.
+  Handle(OpenGl_Context) glContext(const Handle(V3d_View)& view)
+  {
+    const Handle(OpenGl_View) glView = Handle(OpenGl_View)::DownCast(view->View());
+    if (glView.IsNull() || glView->GlWindow().IsNull()) { return Handle(OpenGl_Context)(); }
+    return glView->GlWindow()->GetGlContext();
+  }
+} // namespace
+
+bool FrameReadback::init(const Handle(V3d_View)& view, int width, int height)
+{
+  release(view);
+  m_width  = width;
+  m_height = height;
+
+  const Handle(OpenGl_Context) context = glContext(view);
+  m_fallback                           = context.IsNull() || !context->IsGlGreaterEqual(3, 2);
+  if (m_fallback) { return true; }
+
+  context->MakeCurrent();
+  const OpenGl_GlFunctions* gl = context->Functions();
+  for (Slot& slot : m_slots)
+  {
+    slot.fbo = view->View()->FBOCreate(width, height);
+    if (slot.fbo.IsNull())
+    {
+      release(view);
+      m_width    = width;
+      m_height   = height;
+      m_fallback = true;
+      return true;
+    }
+    gl->glGenBuffers(1, &slot.pbo);
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    gl->glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(width) * height * BYTES_PER_PIXEL, nullptr, GL_STREAM_READ);
+  }
+  gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return true;
+}
+
+bool FrameReadback::render(const Handle(V3d_View)& view, int width, int height, Clock::time_point stamp)
+{
+  if (width != m_width || height != m_height) { init(view, width, height); }
+  if (m_fallback)
+  {
+    if (!view->ToPixMap(m_image, width, height)) { return false; }
+    m_stamp     = stamp;
+    m_has_image = true;
+    return true;
+  }
+
+  const Handle(OpenGl_Context) context = glContext(view);
+  const OpenGl_GlFunctions* gl         = context->Functions();
+  Slot& slot                           = m_slots[m_next];
+  if (slot.pending)
+  {
+    // Rendered twice without a fetch in between, the older frame is dropped
+    gl->glDeleteSync(static_cast<GLsync>(slot.fence));
+    slot.pending = false;
+  }
+
+  const Handle(Standard_Transient) previous = view->View()->FBO();
+  view->View()->SetFBO(slot.fbo);
+  view->Invalidate();
+  view->Redraw();
+  view->View()->SetFBO(previous);
+
+  // The copy into the buffer object is queued behind the frame and does not block
+  const Handle(OpenGl_FrameBuffer) fbo = Handle(OpenGl_FrameBuffer)::DownCast(slot.fbo);
+  context->MakeCurrent();
+  fbo->BindReadBuffer(context);
+  gl->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  gl->glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+  gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  fbo->UnbindBuffer(context);
+  slot.fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  // Submit now, the GUI is drawn in another context meanwhile
+  gl->glFlush();
+
+  slot.pending = true;
+  slot.stamp   = stamp;
+  m_next       = 1 - m_next;
+  m_rendered   = true;
+  return true;
+}
+
+bool FrameReadback::fetch(const Handle(V3d_View)& view, Image_PixMap& image, Clock::time_point& stamp)
+{
+  if (m_fallback)
+  {
+    if (!m_has_image || !image.InitCopy(m_image)) { return false; }
+    stamp       = m_stamp;
+    m_has_image = false;
+    return true;
+  }
+
+  // After render() the next slot holds the older frame; without a render() since the last fetch() the
+  // newest frame is in the other slot, unless that was fetched already
+  Slot& slot = m_slots[m_next].pending || m_rendered ? m_slots[m_next] : m_slots[1 - m_next];
+  m_rendered = false;
+  if (!slot.pending) { return false; }
+
+  const Handle(OpenGl_Context) context = glContext(view);
+  const OpenGl_GlFunctions* gl         = context->Functions();
+  context->MakeCurrent();
+  gl->glClientWaitSync(static_cast<GLsync>(slot.fence), GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+  gl->glDeleteSync(static_cast<GLsync>(slot.fence));
+  slot.fence   = nullptr;
+  slot.pending = false;
+
+  const size_t row_bytes = size_t(m_width) * BYTES_PER_PIXEL;
+  gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  const auto* pixels = static_cast<const Standard_Byte*>(
+      gl->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(row_bytes) * m_height, GL_MAP_READ_BIT));
+  if (pixels != nullptr)
+  {
+    if (image.Format() != Image_Format_RGB || int(image.Width()) != m_width || int(image.Height()) != m_height)
+    {
+      image.InitTrash(Image_Format_RGB, m_width, m_height);
+    }
+    // Rows arrive bottom up, the order of a pixmap that is not top down
+    for (int row = 0; row < m_height; ++row)
+    {
+      const size_t target = image.IsTopDown() ? size_t(m_height - 1 - row) : size_t(row);
+      std::memcpy(image.ChangeData() + target * image.SizeRowBytes(), pixels + row * row_bytes, row_bytes);
+    }
+    gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  stamp = slot.stamp;
+  return pixels != nullptr;
+}
+
+void FrameReadback::release(const Handle(V3d_View)& view)
+{
+  const Handle(OpenGl_Context) context = glContext(view);
+  const OpenGl_GlFunctions* gl         = context.IsNull() ? nullptr : context->Functions();
+  if (gl != nullptr) { context->MakeCurrent(); }
+  for (Slot& slot : m_slots)
+  {
+    if (gl != nullptr && slot.fence != nullptr) { gl->glDeleteSync(static_cast<GLsync>(slot.fence)); }
+    if (gl != nullptr && slot.pbo != 0) { gl->glDeleteBuffers(1, &slot.pbo); }
+    if (!slot.fbo.IsNull()) { view->View()->FBORelease(slot.fbo); }
+    slot = Slot();
+  }
+  m_next      = 0;
+  m_rendered  = false;
+  m_width     = 0;
+  m_height    = 0;
+  m_has_image = false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Image_PixMap.hxx>
+#include <Standard_Transient.hxx>
+#include <V3d_View.hxx>
+
+#include <array>
+#include <chrono>
+
+// Reads an offscreen view back into memory without waiting for the transfer.
+//
+// Frames are rendered into two framebuffers in turn and copied into pixel buffer objects asynchronously.
+// fetch() maps the copy of the previous frame, so reading frame N back overlaps with rendering it and the
+// image shown is one frame old. Contexts without pixel buffer objects and sync objects (OpenGL 3.2) use
+// V3d_View::ToPixMap instead, which waits for the frame.
+class FrameReadback
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  FrameReadback() = default;
+
+  FrameReadback(const FrameReadback&)            = delete;
+  FrameReadback& operator=(const FrameReadback&) = delete;
+
+  // Render the view at the given size and start reading it back. stamp travels with the frame to fetch().
+  bool render(const Handle(V3d_View)& view, int width, int height, Clock::time_point stamp);
+
+  // Copy the frame rendered before the last render() into image, or for a view not rendered again since
+  // the previous fetch() its last frame, which has had a frame to be copied. Returns false when there is none.
+  bool fetch(const Handle(V3d_View)& view, Image_PixMap& image, Clock::time_point& stamp);
+
+  // Free the GL objects; the view's context must still exist.
+  void release(const Handle(V3d_View)& view);
+
+ private:
+  struct Slot
+  {
+    Handle(Standard_Transient) fbo; // OpenGl_FrameBuffer
+    unsigned int pbo = 0;
+    void* fence      = nullptr; // GLsync of the copy
+    bool pending     = false;
+    Clock::time_point stamp;
+  };
+
+  bool init(const Handle(V3d_View)& view, int width, int height);
+
+  std::array<Slot, 2> m_slots;
+  int m_next      = 0;
+  bool m_rendered = false; // render() was called since the last fetch()
+  int m_width     = 0;
+  int m_height    = 0;
+  bool m_fallback = false;
+  Image_PixMap m_image; // frame rendered by the fallback
+  Clock::time_point m_stamp;
+  bool m_has_image = false;
+};
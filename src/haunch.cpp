@@ -1,4 +1,16 @@
 #include "haunch.h"
+#include "overlap.h"
+#include "pair_pipeline.h"
+
+#include <BRepGProp.hxx>
+#include <GProp_GProps.hxx>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <thread>
 
 bool GetFacePlaneNormal(const TopoDS_Face& face, gp_Dir& outNormal)
 {
@@ -18,7 +30,11 @@ bool GetFacePlaneNormal(const TopoDS_Face& face, gp_Dir& outNormal)
 }
 
 // Compare two sets of vertices for equality (within tolerance)
-bool HaveSameVertices(const TopoDS_Face& face1, const TopoDS_Face& face2, float d)
+bool HaveSameVertices(const TopoDS_Face& face1,
+                      const TopoDS_Face& face2,
+                      float d,
+                      double lateral_tol,
+                      double offset_tol)
 {
   TopTools_IndexedMapOfShape verts1, verts2;
   TopExp::MapShapes(face1, TopAbs_VERTEX, verts1);
@@ -48,12 +64,12 @@ bool HaveSameVertices(const TopoDS_Face& face1, const TopoDS_Face& face2, float
       // Lateral difference (should be near zero if p2 is directly offset along the normal)
       gp_Vec lateral = delta - normalDistance * gp_Vec(normal);
       // std::cout << "lateral " << lateral.Magnitude() << "\n";
-      if (lateral.Magnitude() > 1e-4)
+      if (lateral.Magnitude() > lateral_tol)
         continue;
 
       // Check if distance is within expected offset ± tolerance
       // std::cout << normalDistance << " " << d << "\n";
-      if (std::abs(std::abs(normalDistance) - d) < 1e-4)
+      if (std::abs(std::abs(normalDistance) - d) < offset_tol)
       {
         foundMatch = true;
         break;
@@ -67,90 +83,334 @@ bool HaveSameVertices(const TopoDS_Face& face1, const TopoDS_Face& face2, float
   return true;
 }
 
-std::vector<std::pair<TopoDS_Face, gp_Dir>> CollectPlaneFaces(const TopoDS_Shape& shape)
+// Same test as above on precomputed vertex positions, which avoids re-exploring the topology
+// for every candidate pair.
+bool HaveSameVertices(const FaceFeature& face1,
+                      const FaceFeature& face2,
+                      double d,
+                      double lateral_tol,
+                      double offset_tol)
 {
-    std::vector<std::pair<TopoDS_Face, gp_Dir>> planeFaces;
+  const size_t count = face1.vertices.size();
+  if (count != face2.vertices.size())
+    return false;
 
-    for (TopExp_Explorer faceExp(shape, TopAbs_FACE); faceExp.More(); faceExp.Next())
+  const gp_Vec normal(face1.normal);
+  for (const gp_Pnt& p1 : face1.vertices)
+  {
+    bool foundMatch = false;
+    for (const gp_Pnt& p2 : face2.vertices)
     {
-        TopoDS_Face face = TopoDS::Face(faceExp.Current());
-        gp_Dir normal;
-        if (GetFacePlaneNormal(face, normal)) {
-            planeFaces.emplace_back(face, normal);
-        }
+      gp_Vec delta(p1, p2);
+      Standard_Real normalDistance = delta.Dot(normal);
+
+      gp_Vec lateral = delta - normalDistance * normal;
+      if (lateral.Magnitude() > lateral_tol)
+        continue;
+
+      if (std::abs(std::abs(normalDistance) - d) < offset_tol)
+      {
+        foundMatch = true;
+        break;
+      }
+    }
+
+    if (!foundMatch)
+      return false;
+  }
+
+  return true;
+}
+
+// Smallest lateral tolerance for which HaveSameVertices(face1, face2, d, tol, offset_tol) holds,
+// or infinity when no tolerance makes the vertex sets match.
+double RequiredLateralTolerance(const FaceFeature& face1, const FaceFeature& face2, double d, double offset_tol)
+{
+  const double never = std::numeric_limits<double>::infinity();
+  if (face1.vertices.size() != face2.vertices.size())
+    return never;
+
+  const gp_Vec normal(face1.normal);
+  double required = 0.0;
+  for (const gp_Pnt& p1 : face1.vertices)
+  {
+    double best = never;
+    for (const gp_Pnt& p2 : face2.vertices)
+    {
+      gp_Vec delta(p1, p2);
+      Standard_Real normalDistance = delta.Dot(normal);
+      if (std::abs(std::abs(normalDistance) - d) < offset_tol)
+      {
+        best = std::min(best, (delta - normalDistance * normal).Magnitude());
+      }
+    }
+    required = std::max(required, best);
+  }
+
+  return required;
+}
+
+double FaceArea(const TopoDS_Face& face)
+{
+  GProp_GProps props;
+  BRepGProp::SurfaceProperties(face, props);
+  return props.Mass();
+}
+
+// Fraction of the smaller outline covered by the other one, both projected onto the plane of face1.
+double OutlineOverlap(const FaceFeature& face1, const FaceFeature& face2)
+{
+  const gp_Ax2 plane(gp::Origin(), face1.normal);
+  const std::vector<gp_XY> polygon1 = ProjectOutline(face1.outline, plane);
+  const std::vector<gp_XY> polygon2 = ProjectOutline(face2.outline, plane);
+  if (polygon1.size() < 3 || polygon2.size() < 3)
+    return 0.0;
+
+  // Bounding boxes reject most candidates before any clipping
+  const auto box = [](const std::vector<gp_XY>& polygon, gp_XY& lo, gp_XY& hi) {
+    lo = hi = polygon.front();
+    for (const gp_XY& p : polygon)
+    {
+      lo.SetCoord(std::min(lo.X(), p.X()), std::min(lo.Y(), p.Y()));
+      hi.SetCoord(std::max(hi.X(), p.X()), std::max(hi.Y(), p.Y()));
+    }
+  };
+  gp_XY lo1, hi1, lo2, hi2;
+  box(polygon1, lo1, hi1);
+  box(polygon2, lo2, hi2);
+  if (hi1.X() <= lo2.X() || hi2.X() <= lo1.X() || hi1.Y() <= lo2.Y() || hi2.Y() <= lo1.Y())
+    return 0.0;
+
+  const double smaller = std::min(std::abs(PolygonArea(polygon1)), std::abs(PolygonArea(polygon2)));
+  if (smaller <= Precision::SquareConfusion())
+    return 0.0;
+  return PolygonOverlapArea(polygon1, polygon2) / smaller;
+}
+
+bool MatchFeatures(const FaceFeature& face1, const FaceFeature& face2, const HaunchParams& params, double& distance)
+{
+  if (!face1.normal.IsParallel(face2.normal, params.angular_tol))
+    return false;
+
+  distance = std::abs(gp_Vec(face1.centroid, face2.centroid).Dot(gp_Vec(face1.normal)));
+  if (distance > params.max_distance)
+    return false;
+  if (params.min_overlap > 0.0)
+    return distance > Precision::Confusion() && OutlineOverlap(face1, face2) >= params.min_overlap;
+  return HaveSameVertices(face1, face2, distance, params.lateral_tol, params.offset_tol);
+}
+
+void SortHaunchPairs(std::vector<HaunchPair>& pairs)
+{
+  std::sort(pairs.begin(), pairs.end(), [](const HaunchPair& a, const HaunchPair& b) {
+    return a.face1 != b.face1 ? a.face1 < b.face1 : a.face2 < b.face2;
+  });
+}
+
+HaunchResult FindHaunches(const std::shared_ptr<const FaceIndex>& index, const HaunchParams& params)
+{
+  return VisitPipeline(params, [&](auto pipeline) { return FindHaunchesWith<decltype(pipeline)>(index, params); });
+}
+
+HaunchResult FindHaunches(const TopoDS_Shape& shape, const HaunchParams& params)
+{
+  return FindHaunches(std::make_shared<const FaceIndex>(shape, params.min_overlap > 0.0), params);
+}
+
+HaunchResult FindHaunchesForFaces(const std::shared_ptr<const FaceIndex>& index,
+                                  const std::vector<int>& face_ids,
+                                  const HaunchParams& params)
+{
+  HaunchResult result;
+  result.shape      = index->shape();
+  result.index      = index;
+  result.face_count = index->face_count();
+
+  std::vector<int> selected;
+  for (int id : face_ids)
+  {
+    const int feature = id >= 1 && id <= index->face_count() ? index->feature_of(id) : -1;
+    if (feature >= 0) { selected.push_back(feature); }
+  }
+  std::sort(selected.begin(), selected.end());
+  selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
+
+  VisitPipeline(params, [&](auto pipeline) {
+    std::vector<int> candidates;
+    for (int i : selected)
+    {
+      candidates.clear();
+      index->partners(i, params.max_distance, candidates);
+      for (int j : candidates)
+      {
+        // a pair of two selected faces is reported by both of them, keep one
+        if (j < i && std::binary_search(selected.begin(), selected.end(), j))
+          continue;
+        MatchPairWith<decltype(pipeline)>(*index, i, j, params, result.pairs);
+      }
     }
+  });
 
-    return planeFaces;
+  SortHaunchPairs(result.pairs);
+  return result;
 }
 
-void ProcessShapeFacesForParallelPlanes(const Handle(AIS_InteractiveContext)& context, const TopoDS_Shape& shape, float max_distance)
+// Evaluates every setting of the grid in one pass: candidates are collected once with the loosest
+// setting together with the tolerance each of them needs, and settings are then only counted.
+std::vector<HaunchSweepCount> SweepHaunches(const FaceIndex& index, const HaunchSweep& sweep)
 {
-    std::cout << "Processing Shape...\n";
+  struct Candidate
+  {
+    double angle;
+    double distance;
+    double lateral;
+  };
+
+  const auto largest = [](const std::vector<double>& values) {
+    return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+  };
+  const double max_distance = largest(sweep.max_distances);
+  const double max_lateral  = largest(sweep.lateral_tols);
+  const double max_angle    = largest(sweep.angular_tols);
+  if (max_angle > FaceIndex::NORMAL_CELL)
+    return {};
 
-    auto planeFaces = CollectPlaneFaces(shape);
+  // Settings shared by the whole grid are checked with the predicates of the FindHaunches pipelines
+  HaunchParams shared;
+  shared.max_distance   = max_distance;
+  shared.offset_tol     = sweep.offset_tol;
+  shared.min_overlap    = sweep.min_overlap;
+  shared.min_area_ratio = sweep.min_area_ratio;
+
+  std::vector<Candidate> found;
+  std::vector<int> candidates;
+  const auto& features = index.features();
+  for (int i = 0; i < static_cast<int>(features.size()); ++i)
+  {
+    candidates.clear();
+    index.partners(i, max_distance, candidates);
+    for (int j : candidates)
+    {
+      if (j < i)
+        continue;
+
+      const FaceFeature& face1 = features[i];
+      const FaceFeature& face2 = features[j];
+      const double angle       = face1.normal.Angle(face2.normal);
+      const double parallel    = std::min(angle, M_PI - angle);
+      if (parallel > max_angle)
+        continue;
+
+      const double distance = std::abs(gp_Vec(face1.centroid, face2.centroid).Dot(gp_Vec(face1.normal)));
+      if (distance > max_distance)
+        continue;
+
+      PairCandidate candidate { &index, face1, face2 };
+      candidate.distance = distance;
+      double lateral     = 0.0;
+      if (sweep.min_overlap > 0.0)
+      {
+        if (!OutlineMatch::test(candidate, shared))
+          continue;
+      }
+      else
+      {
+        lateral = RequiredLateralTolerance(face1, face2, distance, sweep.offset_tol);
+        if (lateral > max_lateral)
+          continue;
+      }
+      if (AreaRatio::test(candidate, shared)) { found.push_back({ parallel, distance, lateral }); }
+    }
+  }
 
-    for (size_t i = 0; i < planeFaces.size(); ++i)
+  std::vector<HaunchSweepCount> counts;
+  for (double d : sweep.max_distances)
+  {
+    for (double l : sweep.lateral_tols)
     {
-        for (size_t j = i + 1; j < planeFaces.size(); ++j)
+      for (double a : sweep.angular_tols)
+      {
+        size_t hits = 0;
+        for (const Candidate& c : found)
         {
-            // std::cout << "pair " << i << " " << j << "\n";
-            const auto& [face1, normal1] = planeFaces[i];
-            const auto& [face2, normal2] = planeFaces[j];
-
-            if (normal1.IsParallel(normal2, Precision::Angular()))
-            {
-                // std::cout<< "parallel!\n"; 
-                gp_Pnt p1 = BRep_Tool::Surface(face1)->Value(0.0, 0.0);
-                gp_Pnt p2 = BRep_Tool::Surface(face2)->Value(0.0, 0.0);
-                Standard_Real distance = p1.Distance(p2);
-                // std::cout << "dist " << distance << "\n";
-                if (distance <= max_distance)
-                {
-                    // std::cout << "dist " << distance << "\n";
-                    if (HaveSameVertices(face1, face2, distance))
-                    {
-                        // std::cout << "Found parallel, close faces with same vertices\n";
-                        Handle(AIS_Shape) aisFace1 = new AIS_Shape(face1);
-                        Handle(AIS_Shape) aisFace2 = new AIS_Shape(face2);
-
-                        context->SetColor(aisFace1, Quantity_NOC_RED, Standard_False);
-                        context->SetColor(aisFace2, Quantity_NOC_RED, Standard_False);
-
-                        // Set to shaded mode to fill faces with color
-                        context->SetDisplayMode(aisFace1, AIS_Shaded, Standard_False);
-                        context->SetDisplayMode(aisFace2, AIS_Shaded, Standard_False);
-
-                        // Optional: hide edges for pure fill
-                        Handle(Prs3d_Drawer) drawer1 = aisFace1->Attributes();
-                        Handle(Prs3d_Drawer) drawer2 = aisFace2->Attributes();
-                        drawer1->SetFaceBoundaryDraw(false);
-                        drawer2->SetFaceBoundaryDraw(false);
-
-                        // Display and update
-                        context->Display(aisFace1, Standard_False);
-                        context->Display(aisFace2, Standard_False);
-                        context->Redisplay(aisFace1, Standard_False);
-                        context->Redisplay(aisFace2, Standard_False);
-                    }
-                }
-            }
+          if (c.distance <= d && c.lateral <= l && c.angle <= a) { ++hits; }
         }
+        counts.push_back({ d, l, a, hits });
+      }
     }
+  }
+
+  return counts;
 }
 
-void ProcessDisplayedShapes(const Handle(AIS_InteractiveContext)& context, float max_distance)
+std::vector<double> ParseValueList(const std::string& text)
 {
-    AIS_ListOfInteractive aList;
-    context->DisplayedObjects(aList);
-
-    for (AIS_ListIteratorOfListOfInteractive it(aList); it.More(); it.Next())
+  std::vector<double> values;
+  const char* cursor = text.c_str();
+  while (*cursor != '\0')
+  {
+    char* end          = nullptr;
+    const double value = std::strtod(cursor, &end);
+    if (end == cursor)
     {
-        Handle(AIS_InteractiveObject) io = it.Value();
-        Handle(AIS_Shape) aisShape = Handle(AIS_Shape)::DownCast(io);
-        if (aisShape.IsNull())
-            continue;
+      ++cursor;
+      continue;
+    }
+    values.push_back(value);
+    cursor = end;
+  }
+  return values;
+}
 
-        const TopoDS_Shape& shape = aisShape->Shape();
-        ProcessShapeFacesForParallelPlanes(context, shape, max_distance);
+// Faces are colored as sub-shapes of the displayed object, so toggling costs a single
+// presentation rebuild of the parent and nothing is drawn twice.
+void HighlightHaunches(const Handle(AIS_InteractiveContext)& context, const HaunchResult& result, bool on)
+{
+  Handle(AIS_ColoredShape) colored = Handle(AIS_ColoredShape)::DownCast(result.object);
+  if (colored.IsNull() || result.pairs.empty())
+    return;
+
+  for (const HaunchPair& pair : result.pairs)
+  {
+    for (int id : { pair.face1, pair.face2 })
+    {
+      if (on) { colored->SetCustomColor(result.index->face(id), Quantity_NOC_RED); }
+      else { colored->UnsetCustomAspects(result.index->face(id), true); }
     }
-}
\ No newline at end of file
+  }
+  context->Redisplay(colored, Standard_False);
+}
+
+HaunchResult ProcessShapeFacesForParallelPlanes(const Handle(AIS_Shape)& aisShape,
+                                                const HaunchParams& params,
+                                                const std::shared_ptr<const FaceIndex>& index)
+{
+  HaunchResult result = index ? FindHaunches(index, params) : FindHaunches(aisShape->Shape(), params);
+  result.object       = aisShape;
+  return result;
+}
+
+// Objects are taken in the order given by the caller: AIS_InteractiveContext::DisplayedObjects() follows
+// a map keyed by object addresses, so its order changes from run to run.
+std::vector<HaunchResult> ProcessDisplayedShapes(const Handle(AIS_InteractiveContext)& context,
+                                                 const AIS_ListOfInteractive& objects,
+                                                 AnalysisCache& cache,
+                                                 const HaunchParams& params,
+                                                 bool highlight)
+{
+  std::vector<HaunchResult> results;
+
+  for (AIS_ListIteratorOfListOfInteractive it(objects); it.More(); it.Next())
+  {
+    Handle(AIS_InteractiveObject) io = it.Value();
+    Handle(AIS_Shape) aisShape       = Handle(AIS_Shape)::DownCast(io);
+    if (aisShape.IsNull() || !context->IsDisplayed(io))
+      continue;
+
+    const std::shared_ptr<const FaceIndex> index = cache.index(aisShape, params.min_overlap > 0.0);
+    results.push_back(ProcessShapeFacesForParallelPlanes(aisShape, params, index));
+    if (highlight) { HighlightHaunches(context, results.back(), true); }
+  }
+
+  return results;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <AIS_ColoredShape.hxx>
 #include <AIS_Shape.hxx>
 #include <Aspect_DisplayConnection.hxx>
 #include <Aspect_Handle.hxx>
@@ -12,20 +13,127 @@
 
 #include <AIS_InteractiveContext.hxx>
 #include <BRep_Tool.hxx>
+#include <Bnd_Box.hxx>
 #include <GeomAdaptor_Surface.hxx>
 #include <Geom_Plane.hxx>
 #include <Geom_Surface.hxx>
 #include <Standard_Type.hxx>
 #include <TopExp.hxx>
 #include <TopExp_Explorer.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
 #include <TopoDS.hxx>
 #include <TopoDS_Edge.hxx>
 #include <TopoDS_Shape.hxx>
 #include <TopoDS_Vertex.hxx>
 #include <gp_Pnt.hxx>
 
+#include <Precision.hxx>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "analysis_cache.h"
+#include "face_index.h"
+
+// Detection tolerances. angular_tol is the largest angle (radians) between two normals still treated as
+// parallel; it is limited to FaceIndex::NORMAL_CELL, the angular resolution of the index.
+// threads only affects speed: results are identical for any thread count.
+//
+// A positive min_overlap replaces the vertex comparison by the overlap matcher: both outlines are projected
+// onto the common plane and the faces match when their intersection covers at least this fraction of the
+// smaller face. It finds ribs whose sides are split differently, but needs an index built with outlines.
+// A positive min_area_ratio also rejects pairs whose smaller face has less than this fraction of the area
+// of the larger one.
+struct HaunchParams
+{
+  double max_distance   = 20.0;
+  double lateral_tol    = 1e-4;
+  double offset_tol     = 1e-4;
+  double angular_tol    = Precision::Angular();
+  double min_overlap    = 0.0;
+  double min_area_ratio = 0.0;
+  int threads           = 1; // threads of the pair search, 0 for one per hardware thread
+};
+
+// Grid of settings evaluated by SweepHaunches; offset_tol, min_overlap and min_area_ratio are shared by every
+// setting and mean the same as in HaunchParams. With a positive min_overlap pairs are matched by their
+// outlines, so the lateral tolerances do not change the counts and the index needs outlines.
+// Angular tolerances cannot exceed FaceIndex::NORMAL_CELL, see SweepHaunches.
+struct HaunchSweep
+{
+  std::vector<double> max_distances;
+  std::vector<double> lateral_tols;
+  std::vector<double> angular_tols;
+  double offset_tol     = 1e-4;
+  double min_overlap    = 0.0;
+  double min_area_ratio = 0.0;
+};
+
+struct HaunchSweepCount
+{
+  double max_distance;
+  double lateral_tol;
+  double angular_tol;
+  size_t hits;
+};
+
+// Pair of parallel planar faces recognised as the two sides of a haunch.
+// Face ids are 1-based indices into TopExp::MapShapes(shape, TopAbs_FACE, ...),
+// which keeps them stable for the same BREP between runs.
+struct HaunchPair
+{
+  int face1;
+  int face2;
+  double thickness;
+  gp_Dir normal;
+  double area1;
+  double area2;
+  int feature = -1; // position in HaunchResult::features, -1 until GroupRibFeatures ran
+};
+
+// Pairs belonging to one physical rib, see GroupRibFeatures. pairs are positions in HaunchResult::pairs,
+// faces the sorted ids of every face in them. length and height are the extents of the rib sides along
+// and across the rib; thickness is the area weighted mean over the pairs.
+struct RibFeature
+{
+  std::vector<int> pairs;
+  std::vector<int> faces;
+  gp_Dir normal;
+  double thickness = 0.0;
+  double length    = 0.0;
+  double height    = 0.0;
+  Bnd_Box box;
+};
+
+// Detection output for a single shape. object is the displayed presentation the result was
+// computed for and is null when the detector runs without a viewer. pairs are kept in canonical
+// order, sorted by (face1, face2).
+struct HaunchResult
+{
+  TopoDS_Shape shape;
+  Handle(AIS_InteractiveObject) object;
+  std::shared_ptr<const FaceIndex> index;
+  int face_count = 0;
+  std::vector<HaunchPair> pairs;
+  std::vector<RibFeature> features;
+};
+
 bool GetFacePlaneNormal(const TopoDS_Face& face, gp_Dir& outNormal);
-bool HaveSameVertices(const TopoDS_Face& face1, const TopoDS_Face& face2, float d);
-std::vector<std::pair<TopoDS_Face, gp_Dir>> CollectPlaneFaces(const TopoDS_Shape& shape);
-void ProcessShapeFacesForParallelPlanes(const Handle(AIS_InteractiveContext)& context, const TopoDS_Shape& shape, float max_distance);
-void ProcessDisplayedShapes(const Handle(AIS_InteractiveContext)& context, float max_distance);
\ No newline at end of file
+bool HaveSameVertices(const TopoDS_Face& face1, const TopoDS_Face& face2, float d, double lateral_tol = 1e-4, double offset_tol = 1e-4);
+bool HaveSameVertices(const FaceFeature& face1, const FaceFeature& face2, double d, double lateral_tol, double offset_tol);
+double FaceArea(const TopoDS_Face& face);
+double OutlineOverlap(const FaceFeature& face1, const FaceFeature& face2);
+bool MatchFeatures(const FaceFeature& face1, const FaceFeature& face2, const HaunchParams& params, double& distance);
+double RequiredLateralTolerance(const FaceFeature& face1, const FaceFeature& face2, double d, double offset_tol);
+void SortHaunchPairs(std::vector<HaunchPair>& pairs);
+HaunchResult FindHaunches(const TopoDS_Shape& shape, const HaunchParams& params);
+HaunchResult FindHaunches(const std::shared_ptr<const FaceIndex>& index, const HaunchParams& params);
+HaunchResult FindHaunchesForFaces(const std::shared_ptr<const FaceIndex>& index, const std::vector<int>& face_ids, const HaunchParams& params);
+// Hit counts of every combination of the sweep, in (distance, lateral, angular) order. Empty when an angular
+// tolerance is above FaceIndex::NORMAL_CELL: the index does not return partners tilted further.
+std::vector<HaunchSweepCount> SweepHaunches(const FaceIndex& index, const HaunchSweep& sweep);
+std::vector<double> ParseValueList(const std::string& text);
+void HighlightHaunches(const Handle(AIS_InteractiveContext)& context, const HaunchResult& result, bool on);
+HaunchResult ProcessShapeFacesForParallelPlanes(const Handle(AIS_Shape)& aisShape, const HaunchParams& params, const std::shared_ptr<const FaceIndex>& index = nullptr);
+std::vector<HaunchResult> ProcessDisplayedShapes(const Handle(AIS_InteractiveContext)& context, const AIS_ListOfInteractive& objects, AnalysisCache& cache, const HaunchParams& params, bool highlight);
@@ -0,0 +1,162 @@
+#include "haunch_export.h"
+#include "haunch_format.h"
+
+#include <cstdio>
+#include <fstream>
+
+std::string SerializeHaunchResults(const std::vector<HaunchResult>& results)
+{
+  std::vector<rd::ResultShape> shapes;
+  std::vector<rd::ResultPair> pairs;
+  std::vector<rd::ResultFeature> features;
+  std::vector<uint32_t> feature_faces;
+  shapes.reserve(results.size());
+
+  for (size_t s = 0; s < results.size(); ++s)
+  {
+    const HaunchResult& result = results[s];
+
+    rd::ResultShape shape {};
+    shape.face_count = static_cast<uint32_t>(result.face_count);
+    shape.first_pair = static_cast<uint32_t>(pairs.size());
+    shape.pair_count = static_cast<uint32_t>(result.pairs.size());
+    shapes.push_back(shape);
+
+    const uint32_t first_feature = static_cast<uint32_t>(features.size());
+    for (const RibFeature& src : result.features)
+    {
+      rd::ResultFeature feature {};
+      feature.shape      = static_cast<uint32_t>(s);
+      feature.first_face = static_cast<uint32_t>(feature_faces.size());
+      feature.face_count = static_cast<uint32_t>(src.faces.size());
+      feature.pair_count = static_cast<uint32_t>(src.pairs.size());
+      feature.thickness  = static_cast<float>(src.thickness);
+      feature.length     = static_cast<float>(src.length);
+      feature.height     = static_cast<float>(src.height);
+      feature.normal[0]  = static_cast<float>(src.normal.X());
+      feature.normal[1]  = static_cast<float>(src.normal.Y());
+      feature.normal[2]  = static_cast<float>(src.normal.Z());
+      if (!src.box.IsVoid())
+      {
+        double xmin, ymin, zmin, xmax, ymax, zmax;
+        src.box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+        feature.box_min[0] = static_cast<float>(xmin);
+        feature.box_min[1] = static_cast<float>(ymin);
+        feature.box_min[2] = static_cast<float>(zmin);
+        feature.box_max[0] = static_cast<float>(xmax);
+        feature.box_max[1] = static_cast<float>(ymax);
+        feature.box_max[2] = static_cast<float>(zmax);
+      }
+      features.push_back(feature);
+      for (const int face : src.faces) { feature_faces.push_back(static_cast<uint32_t>(face)); }
+    }
+
+    for (const HaunchPair& src : result.pairs)
+    {
+      rd::ResultPair pair {};
+      pair.shape     = static_cast<uint32_t>(s);
+      pair.face1     = static_cast<uint32_t>(src.face1);
+      pair.face2     = static_cast<uint32_t>(src.face2);
+      pair.thickness = static_cast<float>(src.thickness);
+      pair.normal[0] = static_cast<float>(src.normal.X());
+      pair.normal[1] = static_cast<float>(src.normal.Y());
+      pair.normal[2] = static_cast<float>(src.normal.Z());
+      pair.area1     = static_cast<float>(src.area1);
+      pair.area2     = static_cast<float>(src.area2);
+      pair.feature   = src.feature < 0 ? rd::RESULT_NO_FEATURE : first_feature + static_cast<uint32_t>(src.feature);
+      pairs.push_back(pair);
+    }
+  }
+
+  rd::ResultHeader header {};
+  std::memcpy(header.magic, rd::RESULT_MAGIC, sizeof(rd::RESULT_MAGIC));
+  header.version      = rd::RESULT_VERSION;
+  header.header_size  = sizeof(rd::ResultHeader);
+  header.shape_count  = static_cast<uint32_t>(shapes.size());
+  header.pair_count   = static_cast<uint32_t>(pairs.size());
+  header.shape_size   = sizeof(rd::ResultShape);
+  header.pair_size    = sizeof(rd::ResultPair);
+  header.shape_offset = sizeof(rd::ResultHeader);
+  header.pair_offset  = header.shape_offset + shapes.size() * sizeof(rd::ResultShape);
+
+  header.feature_count       = static_cast<uint32_t>(features.size());
+  header.feature_size        = sizeof(rd::ResultFeature);
+  header.feature_offset      = header.pair_offset + pairs.size() * sizeof(rd::ResultPair);
+  header.feature_face_count  = static_cast<uint32_t>(feature_faces.size());
+  header.feature_face_offset = header.feature_offset + features.size() * sizeof(rd::ResultFeature);
+
+  std::string bytes;
+  bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  bytes.append(reinterpret_cast<const char*>(shapes.data()), shapes.size() * sizeof(rd::ResultShape));
+  bytes.append(reinterpret_cast<const char*>(pairs.data()), pairs.size() * sizeof(rd::ResultPair));
+  bytes.append(reinterpret_cast<const char*>(features.data()), features.size() * sizeof(rd::ResultFeature));
+  bytes.append(reinterpret_cast<const char*>(feature_faces.data()), feature_faces.size() * sizeof(uint32_t));
+  return bytes;
+}
+
+bool WriteHaunchResults(const char* path, const std::vector<HaunchResult>& results)
+{
+  const std::string bytes = SerializeHaunchResults(results);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) { return false; }
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  return static_cast<bool>(out);
+}
+
+bool WriteHaunchResultsJson(const char* path, const std::vector<HaunchResult>& results)
+{
+  FILE* out = std::fopen(path, "w");
+  if (out == nullptr) { return false; }
+
+  std::fprintf(out, "{\n  \"version\": %u,\n  \"shapes\": [", rd::RESULT_VERSION);
+  for (size_t s = 0; s < results.size(); ++s)
+  {
+    const HaunchResult& result = results[s];
+    std::fprintf(out,
+                 "%s\n    {\n      \"face_count\": %d,\n      \"pairs\": [",
+                 s == 0 ? "" : ",",
+                 result.face_count);
+    for (size_t i = 0; i < result.pairs.size(); ++i)
+    {
+      const HaunchPair& pair = result.pairs[i];
+      std::fprintf(out,
+                   "%s\n        { \"face1\": %d, \"face2\": %d, \"thickness\": %.9g, \"normal\": [%.9g, %.9g, %.9g], "
+                   "\"area1\": %.9g, \"area2\": %.9g, \"feature\": %d }",
+                   i == 0 ? "" : ",",
+                   pair.face1,
+                   pair.face2,
+                   pair.thickness,
+                   pair.normal.X(),
+                   pair.normal.Y(),
+                   pair.normal.Z(),
+                   pair.area1,
+                   pair.area2,
+                   pair.feature);
+    }
+    std::fprintf(out, "%s],\n      \"features\": [", result.pairs.empty() ? "" : "\n      ");
+    for (size_t i = 0; i < result.features.size(); ++i)
+    {
+      const RibFeature& feature = result.features[i];
+      std::fprintf(out,
+                   "%s\n        { \"thickness\": %.9g, \"length\": %.9g, \"height\": %.9g, "
+                   "\"normal\": [%.9g, %.9g, %.9g], \"pair_count\": %zu, \"faces\": [",
+                   i == 0 ? "" : ",",
+                   feature.thickness,
+                   feature.length,
+                   feature.height,
+                   feature.normal.X(),
+                   feature.normal.Y(),
+                   feature.normal.Z(),
+                   feature.pairs.size());
+      for (size_t f = 0; f < feature.faces.size(); ++f)
+      {
+        std::fprintf(out, "%s%d", f == 0 ? "" : ", ", feature.faces[f]);
+      }
+      std::fprintf(out, "] }");
+    }
+    std::fprintf(out, "%s]\n    }", result.features.empty() ? "" : "\n      ");
+  }
+  std::fprintf(out, "%s]\n}\n", results.empty() ? "" : "\n  ");
+
+  return std::fclose(out) == 0;
+}
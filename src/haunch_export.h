@@ -0,0 +1,15 @@
+#pragma once
+
+#include "haunch.h"
+
+#include <string>
+#include <vector>
+
+// Contents of the binary result file, byte for byte.
+std::string SerializeHaunchResults(const std::vector<HaunchResult>& results);
+
+// Write detection results in the binary format described in haunch_format.h.
+bool WriteHaunchResults(const char* path, const std::vector<HaunchResult>& results);
+
+// Write the same content as human readable JSON, meant for debugging only.
+bool WriteHaunchResultsJson(const char* path, const std::vector<HaunchResult>& results);
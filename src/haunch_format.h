@@ -0,0 +1,216 @@
+#pragma once
+
+// Binary haunch result format (.rdr) and a header-only reader for downstream tools.
+//
+// The file is a flat little-endian image that can be mapped and used in place:
+//
+//   ResultHeader                                   at offset 0
+//   ResultShape[header.shape_count]                at header.shape_offset
+//   ResultPair[header.pair_count]                  at header.pair_offset
+//   ResultFeature[header.feature_count]            at header.feature_offset        (version 2)
+//   uint32_t face ids[header.feature_face_count]   at header.feature_face_offset   (version 2)
+//
+// Face ids are 1-based indices into TopExp::MapShapes(shape, TopAbs_FACE, ...) of the analysed shape.
+// A rib feature lists its faces as a range of the face id table; every pair names its feature.
+// Version 1 files have no features: the fields holding them were reserved and are zero.
+// This header intentionally depends on nothing but the C++ standard library and the OS mapping API.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rd
+{
+  static constexpr char RESULT_MAGIC[4]       = { 'R', 'D', 'R', 'F' };
+  static constexpr uint32_t RESULT_VERSION    = 2;
+  static constexpr uint32_t RESULT_MIN_COMPAT = 1;
+  static constexpr uint32_t RESULT_NO_FEATURE = 0xFFFFFFFFu; // ResultPair::feature of ungrouped pairs
+
+  struct ResultHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t shape_count;
+    uint32_t pair_count;
+    uint32_t shape_size;
+    uint32_t pair_size;
+    uint32_t feature_count;
+    uint64_t shape_offset;
+    uint64_t pair_offset;
+    uint64_t feature_offset;
+    uint64_t feature_face_offset;
+    uint32_t feature_size;
+    uint32_t feature_face_count;
+    uint64_t reserved;
+  };
+
+  struct ResultShape
+  {
+    uint32_t face_count;
+    uint32_t first_pair;
+    uint32_t pair_count;
+    uint32_t reserved;
+  };
+
+  struct ResultPair
+  {
+    uint32_t shape;
+    uint32_t face1;
+    uint32_t face2;
+    float thickness;
+    float normal[3];
+    float area1;
+    float area2;
+    uint32_t feature; // index into the feature table, 0 in version 1
+  };
+
+  struct ResultFeature
+  {
+    uint32_t shape;
+    uint32_t first_face; // into the face id table
+    uint32_t face_count;
+    uint32_t pair_count;
+    float thickness;
+    float length;
+    float height;
+    float normal[3];
+    float box_min[3];
+    float box_max[3];
+  };
+
+  static_assert(sizeof(ResultHeader) == 80, "ResultHeader layout is part of the file format");
+  static_assert(sizeof(ResultShape) == 16, "ResultShape layout is part of the file format");
+  static_assert(sizeof(ResultPair) == 40, "ResultPair layout is part of the file format");
+  static_assert(sizeof(ResultFeature) == 64, "ResultFeature layout is part of the file format");
+
+  // Read-only memory mapping of a result file. Accessors return pointers straight into the mapping.
+  class ResultFile
+  {
+   public:
+    ResultFile() = default;
+    explicit ResultFile(const char* path) { open(path); }
+    ~ResultFile() { close(); }
+
+    ResultFile(const ResultFile&)            = delete;
+    ResultFile& operator=(const ResultFile&) = delete;
+
+    bool open(const char* path)
+    {
+      close();
+      if (!map(path)) { return false; }
+      if (!validate())
+      {
+        close();
+        return false;
+      }
+      return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+      if (m_data != nullptr) { UnmapViewOfFile(m_data); }
+      if (m_mapping != nullptr) { CloseHandle(m_mapping); }
+      if (m_file != INVALID_HANDLE_VALUE) { CloseHandle(m_file); }
+      m_mapping = nullptr;
+      m_file    = INVALID_HANDLE_VALUE;
+#else
+      if (m_data != nullptr) { munmap(const_cast<unsigned char*>(m_data), m_size); }
+#endif
+      m_data = nullptr;
+      m_size = 0;
+    }
+
+    bool is_open() const { return m_data != nullptr; }
+
+    const ResultHeader& header() const { return *reinterpret_cast<const ResultHeader*>(m_data); }
+
+    uint32_t shape_count() const { return header().shape_count; }
+    const ResultShape* shapes() const { return at<ResultShape>(header().shape_offset); }
+
+    uint32_t pair_count() const { return header().pair_count; }
+    const ResultPair* pairs() const { return at<ResultPair>(header().pair_offset); }
+
+    uint32_t feature_count() const { return header().version < 2 ? 0 : header().feature_count; }
+    const ResultFeature* features() const { return at<ResultFeature>(header().feature_offset); }
+    const uint32_t* feature_faces() const { return at<uint32_t>(header().feature_face_offset); }
+
+   private:
+    template<typename T>
+    const T* at(uint64_t offset) const
+    {
+      return reinterpret_cast<const T*>(m_data + offset);
+    }
+
+    bool map(const char* path)
+    {
+#ifdef _WIN32
+      m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (m_file == INVALID_HANDLE_VALUE) { return false; }
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) { return false; }
+      m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (m_mapping == nullptr) { return false; }
+      m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+      m_size = static_cast<size_t>(size.QuadPart);
+#else
+      const int fd = ::open(path, O_RDONLY);
+      if (fd < 0) { return false; }
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size == 0)
+      {
+        ::close(fd);
+        return false;
+      }
+      void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (data == MAP_FAILED) { return false; }
+      m_data = static_cast<const unsigned char*>(data);
+      m_size = static_cast<size_t>(st.st_size);
+#endif
+      return m_data != nullptr;
+    }
+
+    bool fits(uint64_t offset, uint64_t count, uint64_t size) const
+    {
+      return offset <= m_size && count <= (m_size - offset) / (size == 0 ? 1 : size);
+    }
+
+    // Only checks that every table lies inside the mapping; record contents are trusted.
+    bool validate() const
+    {
+      if (m_size < sizeof(ResultHeader)) { return false; }
+      const ResultHeader& h = header();
+      if (std::memcmp(h.magic, RESULT_MAGIC, sizeof(RESULT_MAGIC)) != 0) { return false; }
+      if (h.version < RESULT_MIN_COMPAT || h.version > RESULT_VERSION) { return false; }
+      if (h.shape_size != sizeof(ResultShape) || h.pair_size != sizeof(ResultPair)) { return false; }
+      if (!fits(h.shape_offset, h.shape_count, h.shape_size) || !fits(h.pair_offset, h.pair_count, h.pair_size))
+      {
+        return false;
+      }
+      if (h.version < 2) { return true; }
+      return h.feature_size == sizeof(ResultFeature) && fits(h.feature_offset, h.feature_count, h.feature_size)
+          && fits(h.feature_face_offset, h.feature_face_count, sizeof(uint32_t));
+    }
+
+    const unsigned char* m_data = nullptr;
+    size_t m_size               = 0;
+#ifdef _WIN32
+    HANDLE m_file    = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+  };
+} // namespace rd
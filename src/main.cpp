@@ -20,9 +20,12 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #include "GlfwOcctView.h"
+#include "batch.h"
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
+  if (IsBatchInvocation(argc, argv)) { return RunBatch(argc, argv); }
+
   GlfwOcctView anApp;
   try
   {
@@ -0,0 +1,155 @@
+#include "mesh_lod.h"
+
+#include <BRepBndLib.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRep_TFace.hxx>
+#include <BRep_Tool.hxx>
+#include <Poly_ListOfTriangulation.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+namespace
+{
+  static constexpr double ANGULAR_DEFLECTION = 0.5;
+
+  // Instances of a face share its TShape and therefore its triangulation list, so each one is kept once.
+  std::vector<TopoDS_Face> distinctFaces(const TopoDS_Shape& shape)
+  {
+    TopTools_IndexedMapOfShape map;
+    TopExp::MapShapes(shape, TopAbs_FACE, map);
+
+    std::unordered_set<const TopoDS_TShape*> seen;
+    std::vector<TopoDS_Face> faces;
+    for (int i = 1; i <= map.Extent(); ++i)
+    {
+      if (seen.insert(map(i).TShape().get()).second) { faces.push_back(TopoDS::Face(map(i))); }
+    }
+    return faces;
+  }
+
+  std::vector<Handle(Poly_Triangulation)> activeTriangulations(const std::vector<TopoDS_Face>& faces)
+  {
+    std::vector<Handle(Poly_Triangulation)> triangulations;
+    triangulations.reserve(faces.size());
+    for (const TopoDS_Face& face : faces)
+    {
+      TopLoc_Location location;
+      triangulations.push_back(BRep_Tool::Triangulation(face, location));
+    }
+    return triangulations;
+  }
+} // namespace
+
+const std::vector<double>& MeshLod::default_levels()
+{
+  static const std::vector<double> levels = { 0.01, 0.002, 0.0004 };
+  return levels;
+}
+
+MeshLod::MeshLod(const TopoDS_Shape& shape, const std::vector<double>& relative_deflections) :
+    m_shape(shape), m_faces(distinctFaces(shape))
+{
+  BRepBndLib::Add(shape, m_box);
+  const double diagonal = m_box.IsVoid() ? 1.0 : std::sqrt(m_box.SquareExtent());
+  for (double relative : relative_deflections) { m_deflections.push_back(relative * diagonal); }
+
+  // Triangulations stored in the file stay on their faces next to the levels. The coarse level is meshed on a
+  // copy without them, since the mesher would otherwise keep a stored triangulation as the coarse level.
+  m_stored                = activeTriangulations(m_faces);
+  const TopoDS_Shape copy = BRepBuilderAPI_Copy(m_shape, false, false).Shape();
+  BRepMesh_IncrementalMesh(copy, m_deflections.front(), false, ANGULAR_DEFLECTION, true);
+  m_levels.push_back(activeTriangulations(distinctFaces(copy)));
+  activate(0);
+}
+
+MeshLod::~MeshLod()
+{
+  m_cancel = true;
+  if (m_worker.joinable()) { m_worker.join(); }
+}
+
+int MeshLod::choose_level(double pixels_per_unit, double max_error_px) const
+{
+  for (int level = 0; level < level_count(); ++level)
+  {
+    if (m_deflections[level] * pixels_per_unit <= max_error_px) { return level; }
+  }
+  return level_count() - 1;
+}
+
+bool MeshLod::request(int level)
+{
+  m_requested = std::clamp(level, 0, level_count() - 1);
+  if (m_requested >= available_levels()) { refine_async(); }
+
+  const int target = std::min(m_requested, available_levels() - 1);
+  if (target == m_active) { return false; }
+  activate(target);
+  return true;
+}
+
+bool MeshLod::poll()
+{
+  std::vector<std::vector<Handle(Poly_Triangulation)>> finished;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    finished.swap(m_finished);
+  }
+  if (finished.empty()) { return false; }
+
+  for (auto& level : finished) { m_levels.push_back(std::move(level)); }
+  if (available_levels() == level_count() && m_worker.joinable()) { m_worker.join(); }
+
+  const int target = std::min(m_requested, available_levels() - 1);
+  if (target == m_active) { return false; }
+  activate(target);
+  return true;
+}
+
+void MeshLod::refine_async()
+{
+  if (m_worker.joinable() || available_levels() == level_count()) { return; }
+
+  // The worker meshes a copy sharing the geometry, so the displayed topology is never touched off the main
+  // thread. The copy keeps the face order and sharing, hence triangulations map back by position.
+  const TopoDS_Shape copy = BRepBuilderAPI_Copy(m_shape, false, false).Shape();
+  const std::vector<double> deflections(m_deflections.begin() + available_levels(), m_deflections.end());
+
+  m_worker = std::thread([this, copy, deflections]() {
+    const std::vector<TopoDS_Face> faces = distinctFaces(copy);
+    for (double deflection : deflections)
+    {
+      if (m_cancel) { return; }
+      BRepMesh_IncrementalMesh(copy, deflection, false, ANGULAR_DEFLECTION, true);
+      std::vector<Handle(Poly_Triangulation)> triangulations = activeTriangulations(faces);
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_finished.push_back(std::move(triangulations));
+    }
+  });
+}
+
+void MeshLod::activate(int level)
+{
+  for (size_t i = 0; i < m_faces.size(); ++i)
+  {
+    const Handle(Poly_Triangulation)& active = m_levels[level][i];
+    if (active.IsNull()) { continue; }
+
+    Poly_ListOfTriangulation triangulations;
+    for (const auto& triangulationsOfLevel : m_levels)
+    {
+      if (!triangulationsOfLevel[i].IsNull()) { triangulations.Append(triangulationsOfLevel[i]); }
+    }
+    if (!m_stored[i].IsNull()) { triangulations.Append(m_stored[i]); }
+    Handle(BRep_TFace) tface = Handle(BRep_TFace)::DownCast(m_faces[i].TShape());
+    tface->Triangulations(triangulations, active);
+  }
+  m_active = level;
+}
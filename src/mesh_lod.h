@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Bnd_Box.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TopoDS_Face.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Multi-level triangulation of one displayed shape.
+//
+// Every face keeps a Poly_Triangulation per level in its triangulation list (BRep_TFace::Triangulations),
+// and switching the level only changes which one is active. The coarsest level is meshed up front; finer
+// levels are produced on a worker thread the first time they are asked for and merged by poll().
+// Triangulations the shape already had, e.g. stored in a BREP file, are kept in the lists but never active.
+// The presentation has to be displayed with auto triangulation disabled so that it uses the active level.
+class MeshLod
+{
+ public:
+  // Deflections of the levels relative to the bounding box diagonal, from coarse to fine.
+  static const std::vector<double>& default_levels();
+
+  explicit MeshLod(const TopoDS_Shape& shape, const std::vector<double>& relative_deflections = default_levels());
+  ~MeshLod();
+
+  MeshLod(const MeshLod&)            = delete;
+  MeshLod& operator=(const MeshLod&) = delete;
+
+  const Bnd_Box& bounding_box() const { return m_box; }
+
+  int level_count() const { return static_cast<int>(m_deflections.size()); }
+  int available_levels() const { return static_cast<int>(m_levels.size()); }
+  int active_level() const { return m_active; }
+  double deflection(int level) const { return m_deflections[level]; }
+
+  // Coarsest level whose chordal error stays below max_error_px on screen.
+  int choose_level(double pixels_per_unit, double max_error_px = 1.0) const;
+
+  // Make a level active, starting its background meshing if needed. Returns true when the active
+  // triangulation changed and the presentation must be recomputed.
+  bool request(int level);
+
+  // Merge levels finished by the worker. Returns true when the requested level became active.
+  bool poll();
+
+ private:
+  void refine_async();
+  void activate(int level);
+
+  TopoDS_Shape m_shape;
+  Bnd_Box m_box;
+  std::vector<TopoDS_Face> m_faces; // one face per distinct TShape, in TopExp::MapShapes order
+  std::vector<double> m_deflections;
+  std::vector<std::vector<Handle(Poly_Triangulation)>> m_levels; // [level][face]
+  std::vector<Handle(Poly_Triangulation)> m_stored;              // [face], triangulations read with the shape
+  int m_active    = -1;
+  int m_requested = 0;
+
+  std::thread m_worker;
+  std::mutex m_mutex;
+  std::vector<std::vector<Handle(Poly_Triangulation)>> m_finished; // guarded by m_mutex
+  std::atomic<bool> m_cancel { false };
+};
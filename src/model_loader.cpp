@@ -0,0 +1,222 @@
+#include "model_loader.h"
+#include "profiler.h"
+
+#include <BRepTools.hxx>
+#include <BRep_Builder.hxx>
+#include <IFSelect_ReturnStatus.hxx>
+#include <IGESControl_Reader.hxx>
+#include <STEPControl_Reader.hxx>
+#include <Standard_Failure.hxx>
+#include <XSControl_Reader.hxx>
+
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <filesystem>
+#include <future>
+
+namespace
+{
+  enum class ModelFormat
+  {
+    Unknown,
+    Brep,
+    Step,
+    Iges
+  };
+
+  ModelFormat formatOf(const std::string& path)
+  {
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (ext == ".brep" || ext == ".brp") { return ModelFormat::Brep; }
+    if (ext == ".step" || ext == ".stp") { return ModelFormat::Step; }
+    if (ext == ".iges" || ext == ".igs") { return ModelFormat::Iges; }
+    return ModelFormat::Unknown;
+  }
+
+  std::unique_ptr<XSControl_Reader> makeReader(ModelFormat format)
+  {
+    switch (format)
+    {
+    case ModelFormat::Step:
+      return std::make_unique<STEPControl_Reader>();
+    case ModelFormat::Iges:
+      return std::make_unique<IGESControl_Reader>();
+    default:
+      return nullptr;
+    }
+  }
+
+  std::string fileLabel(const std::string& path) { return std::filesystem::path(path).filename().string(); }
+
+  double elapsedMs(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+} // namespace
+
+bool IsSupportedModel(const std::string& path) { return formatOf(path) != ModelFormat::Unknown; }
+
+bool ReadModel(const std::string& path, TopoDS_Shape& shape)
+{
+  const ModelFormat format = formatOf(path);
+  Profiler::Scope timer("read " + fileLabel(path));
+  if (format == ModelFormat::Brep)
+  {
+    BRep_Builder builder;
+    return BRepTools::Read(shape, path.c_str(), builder);
+  }
+
+  std::unique_ptr<XSControl_Reader> reader = makeReader(format);
+  if (!reader || reader->ReadFile(path.c_str()) != IFSelect_RetDone) { return false; }
+  reader->TransferRoots();
+  shape = reader->OneShape();
+  return !shape.IsNull();
+}
+
+ModelLoader::~ModelLoader()
+{
+  // Loads are only added by load_async() and removed by take_ready(), neither of which can run any more
+  for (Load& load : m_loads) { load.thread.join(); }
+}
+
+void ModelLoader::load_async(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const size_t load = m_first + m_loads.size();
+  m_loads.emplace_back();
+  m_loads.back().path = path;
+
+  ++m_running;
+  // Started under the lock, so the load is complete before the thread can look it up
+  m_loads.back().thread = std::thread([this, path, load]() {
+    std::string error;
+    try
+    {
+      run(path, load);
+    }
+    catch (const Standard_Failure& failure)
+    {
+      error = failure.GetMessageString();
+    }
+    catch (const std::exception& failure)
+    {
+      error = failure.what();
+    }
+    catch (...)
+    {
+      error = "Unknown error";
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!error.empty()) { m_errors.push_back(path + ": " + error); }
+      at(load).done = true;
+    }
+    --m_running;
+  });
+}
+
+std::vector<LoadedShape> ModelLoader::take_ready()
+{
+  std::vector<LoadedShape> ready;
+  std::vector<std::thread> ended;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Roots of the oldest unfinished load are released as they come; later loads wait for it
+    while (!m_loads.empty())
+    {
+      Load& load = m_loads.front();
+      for (LoadedShape& shape : load.shapes) { ready.push_back(std::move(shape)); }
+      load.shapes.clear();
+      if (!load.done)
+        break;
+      m_finished.push_back(load.path);
+      ended.push_back(std::move(load.thread));
+      m_loads.pop_front();
+      ++m_first;
+    }
+  }
+  // A done load's thread only has its running count left to update, so these joins return right away
+  for (std::thread& thread : ended) { thread.join(); }
+  return ready;
+}
+
+std::vector<std::string> ModelLoader::take_finished()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::string> finished;
+  finished.swap(m_finished);
+  return finished;
+}
+
+std::vector<std::string> ModelLoader::take_errors()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::string> errors;
+  errors.swap(m_errors);
+  return errors;
+}
+
+void ModelLoader::push(size_t load, LoadedShape&& shape)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  at(load).shapes.push_back(std::move(shape));
+}
+
+void ModelLoader::run(const std::string& path, size_t load)
+{
+  const auto start         = std::chrono::steady_clock::now();
+  const std::string label  = fileLabel(path);
+  const ModelFormat format = formatOf(path);
+
+  std::error_code error;
+  const auto size = std::filesystem::file_size(path, error);
+  if (!error) { Profiler::instance().record("size " + label, size / (1024.0 * 1024.0), "MB"); }
+
+  if (format == ModelFormat::Brep)
+  {
+    TopoDS_Shape shape;
+    if (!ReadModel(path, shape)) { throw Standard_Failure("Failed to read BREP file"); }
+    const auto meshStart = std::chrono::steady_clock::now();
+    push(load, { label, path, shape, std::make_shared<MeshLod>(shape) });
+    Profiler::instance().record("mesh " + label, elapsedMs(meshStart));
+    Profiler::instance().record("load " + label, elapsedMs(start));
+    return;
+  }
+
+  std::unique_ptr<XSControl_Reader> reader = makeReader(format);
+  if (!reader) { throw Standard_Failure("Unsupported file format"); }
+  {
+    Profiler::Scope timer("read " + label);
+    if (reader->ReadFile(path.c_str()) != IFSelect_RetDone) { throw Standard_Failure("Failed to read file"); }
+  }
+
+  // The XSControl work session is not thread safe, so roots are translated in order while the previous
+  // root is meshed on another thread.
+  double translateMs = 0.0;
+  double meshMs      = 0.0;
+  std::future<void> meshing;
+  const int roots = reader->NbRootsForTransfer();
+  for (int i = 1; i <= roots; ++i)
+  {
+    const auto translateStart = std::chrono::steady_clock::now();
+    if (!reader->TransferRoot(i)) { continue; }
+    const TopoDS_Shape shape = reader->Shape(reader->NbShapes());
+    translateMs += elapsedMs(translateStart);
+    if (shape.IsNull()) { continue; }
+
+    if (meshing.valid()) { meshing.get(); }
+    meshing = std::async(std::launch::async, [this, load, &path, label, shape, &meshMs]() {
+      const auto meshStart = std::chrono::steady_clock::now();
+      auto lod             = std::make_shared<MeshLod>(shape);
+      meshMs += elapsedMs(meshStart);
+      push(load, { label, path, shape, lod });
+    });
+  }
+  if (meshing.valid()) { meshing.get(); }
+
+  Profiler::instance().record("translate " + label, translateMs);
+  Profiler::instance().record("mesh " + label, meshMs);
+  Profiler::instance().record("load " + label, elapsedMs(start));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "mesh_lod.h"
+
+#include <TopoDS_Shape.hxx>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Read a BREP, STEP or IGES file into a single shape. Used where the whole model is needed at once.
+bool ReadModel(const std::string& path, TopoDS_Shape& shape);
+
+// True for the file extensions ReadModel understands.
+bool IsSupportedModel(const std::string& path);
+
+// Shape ready to be displayed, with its coarse triangulation already computed.
+struct LoadedShape
+{
+  std::string source; // file name, used as a label
+  std::string path;   // file as passed to load_async()
+  TopoDS_Shape shape;
+  std::shared_ptr<MeshLod> lod;
+};
+
+// Background model loading for the viewer.
+//
+// STEP and IGES roots are translated one after another and each root is meshed while the next one is being
+// translated; finished roots can be displayed right away instead of waiting for the whole file. Read,
+// translation and meshing times are recorded in the profiler.
+class ModelLoader
+{
+ public:
+  ModelLoader() = default;
+  ~ModelLoader();
+
+  ModelLoader(const ModelLoader&)            = delete;
+  ModelLoader& operator=(const ModelLoader&) = delete;
+
+  void load_async(const std::string& path);
+
+  // Shapes finished since the previous call. Shapes come out in the order their files were requested, so the
+  // display order does not depend on which load finishes first. Loads taken completely are dropped and their
+  // threads joined.
+  std::vector<LoadedShape> take_ready();
+
+  // Files whose load ended, successfully or not, and whose shapes have all been taken, since the previous call.
+  std::vector<std::string> take_finished();
+
+  // Error messages of failed loads since the previous call.
+  std::vector<std::string> take_errors();
+
+  bool busy() const { return m_running > 0; }
+
+ private:
+  struct Load
+  {
+    std::string path;
+    std::thread thread;
+    std::vector<LoadedShape> shapes; // finished, not taken yet
+    bool done = false;
+  };
+
+  void run(const std::string& path, size_t load);
+  void push(size_t load, LoadedShape&& shape);
+  Load& at(size_t load) { return m_loads[load - m_first]; }
+
+  std::atomic<int> m_running { 0 };
+  std::mutex m_mutex;
+  std::deque<Load> m_loads;            // guarded by m_mutex, one per load_async() call not taken completely
+  size_t m_first = 0;                  // guarded by m_mutex, number of the load at the front of m_loads
+  std::vector<std::string> m_errors;   // guarded by m_mutex
+  std::vector<std::string> m_finished; // guarded by m_mutex
+};
@@ -0,0 +1,150 @@
+#include "overlap.h"
+
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepTools.hxx>
+#include <BRepTools_WireExplorer.hxx>
+#include <BRep_Tool.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Wire.hxx>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+  static constexpr int CURVE_SAMPLES = 8;
+
+  struct Triangle
+  {
+    std::array<gp_XY, 3> corners; // counter-clockwise
+    double sign;                  // +1 or -1, orientation in the fan
+    gp_XY min;
+    gp_XY max;
+  };
+
+  std::vector<Triangle> fan(const std::vector<gp_XY>& polygon)
+  {
+    std::vector<Triangle> triangles;
+    for (size_t i = 1; i + 1 < polygon.size(); ++i)
+    {
+      Triangle t { { polygon[0], polygon[i], polygon[i + 1] }, 1.0, {}, {} };
+      const double twice_area = (t.corners[1] - t.corners[0]) ^ (t.corners[2] - t.corners[0]);
+      if (twice_area == 0.0)
+        continue;
+      if (twice_area < 0.0)
+      {
+        std::swap(t.corners[1], t.corners[2]);
+        t.sign = -1.0;
+      }
+      t.min.SetCoord(std::min({ t.corners[0].X(), t.corners[1].X(), t.corners[2].X() }),
+                     std::min({ t.corners[0].Y(), t.corners[1].Y(), t.corners[2].Y() }));
+      t.max.SetCoord(std::max({ t.corners[0].X(), t.corners[1].X(), t.corners[2].X() }),
+                     std::max({ t.corners[0].Y(), t.corners[1].Y(), t.corners[2].Y() }));
+      triangles.push_back(t);
+    }
+    return triangles;
+  }
+
+  // Sutherland-Hodgman clipping of triangle a by triangle b, both counter-clockwise; returns the area.
+  double clippedArea(const Triangle& a, const Triangle& b)
+  {
+    // A triangle clipped by three half-planes keeps at most six vertices
+    std::array<gp_XY, 9> buffers[2];
+    int count = 3;
+    std::copy(a.corners.begin(), a.corners.end(), buffers[0].begin());
+
+    int current = 0;
+    for (int e = 0; e < 3 && count > 0; ++e)
+    {
+      const gp_XY& p   = b.corners[e];
+      const gp_XY edge = b.corners[(e + 1) % 3] - p;
+      const auto& in   = buffers[current];
+      auto& out        = buffers[1 - current];
+      int out_count    = 0;
+      for (int i = 0; i < count; ++i)
+      {
+        const gp_XY& s      = in[i];
+        const gp_XY& t      = in[(i + 1) % count];
+        const double side_s = edge ^ (s - p);
+        const double side_t = edge ^ (t - p);
+        if (side_s >= 0.0) { out[out_count++] = s; }
+        if ((side_s >= 0.0) != (side_t >= 0.0)) { out[out_count++] = s + (t - s) * (side_s / (side_s - side_t)); }
+      }
+      count   = out_count;
+      current = 1 - current;
+    }
+
+    double twice_area   = 0.0;
+    const auto& clipped = buffers[current];
+    for (int i = 0; i < count; ++i) { twice_area += clipped[i] ^ clipped[(i + 1) % count]; }
+    return 0.5 * std::abs(twice_area);
+  }
+} // namespace
+
+std::vector<gp_Pnt> FaceOutline(const TopoDS_Face& face)
+{
+  std::vector<gp_Pnt> outline;
+  const TopoDS_Wire wire = BRepTools::OuterWire(face);
+  if (wire.IsNull())
+    return outline;
+
+  for (BRepTools_WireExplorer it(wire, face); it.More(); it.Next())
+  {
+    const TopoDS_Edge& edge = it.Current();
+    if (BRep_Tool::Degenerated(edge))
+      continue;
+
+    outline.push_back(BRep_Tool::Pnt(it.CurrentVertex()));
+    const BRepAdaptor_Curve curve(edge);
+    if (curve.GetType() == GeomAbs_Line)
+      continue;
+
+    // Interior samples in the direction the wire runs through the edge
+    const bool reversed = it.Orientation() == TopAbs_REVERSED;
+    for (int i = 1; i < CURVE_SAMPLES; ++i)
+    {
+      const double s = static_cast<double>(i) / CURVE_SAMPLES;
+      const double u = reversed ? curve.LastParameter() - s * (curve.LastParameter() - curve.FirstParameter())
+                                : curve.FirstParameter() + s * (curve.LastParameter() - curve.FirstParameter());
+      outline.push_back(curve.Value(u));
+    }
+  }
+  return outline;
+}
+
+std::vector<gp_XY> ProjectOutline(const std::vector<gp_Pnt>& outline, const gp_Ax2& plane)
+{
+  const gp_XYZ x = plane.XDirection().XYZ();
+  const gp_XYZ y = plane.YDirection().XYZ();
+  std::vector<gp_XY> polygon;
+  polygon.reserve(outline.size());
+  for (const gp_Pnt& point : outline) { polygon.emplace_back(x.Dot(point.XYZ()), y.Dot(point.XYZ())); }
+  return polygon;
+}
+
+double PolygonArea(const std::vector<gp_XY>& polygon)
+{
+  double twice_area = 0.0;
+  for (size_t i = 0; i < polygon.size(); ++i) { twice_area += polygon[i] ^ polygon[(i + 1) % polygon.size()]; }
+  return 0.5 * twice_area;
+}
+
+double PolygonOverlapArea(const std::vector<gp_XY>& a, const std::vector<gp_XY>& b)
+{
+  const std::vector<Triangle> fan_a = fan(a);
+  const std::vector<Triangle> fan_b = fan(b);
+
+  double area = 0.0;
+  for (const Triangle& ta : fan_a)
+  {
+    for (const Triangle& tb : fan_b)
+    {
+      if (ta.max.X() <= tb.min.X() || tb.max.X() <= ta.min.X() || ta.max.Y() <= tb.min.Y() || tb.max.Y() <= ta.min.Y())
+        continue;
+      area += ta.sign * tb.sign * clippedArea(ta, tb);
+    }
+  }
+  // The fans of both polygons have the winding of their polygon, so the sum carries the product of both signs
+  return std::abs(area);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <TopoDS_Face.hxx>
+#include <gp_Ax2.hxx>
+#include <gp_Pnt.hxx>
+#include <gp_XY.hxx>
+
+#include <vector>
+
+// Outer boundary of a face as an ordered polygon. Straight edges contribute their start vertex, curved
+// edges are sampled. Holes are not part of the outline.
+std::vector<gp_Pnt> FaceOutline(const TopoDS_Face& face);
+
+// Polygon in the frame of a plane: coordinates along its X and Y directions.
+std::vector<gp_XY> ProjectOutline(const std::vector<gp_Pnt>& outline, const gp_Ax2& plane);
+
+// Signed area, positive for counter-clockwise polygons.
+double PolygonArea(const std::vector<gp_XY>& polygon);
+
+// Area of the intersection of two simple, possibly non-convex polygons.
+//
+// Both polygons are split into a fan of signed triangles around their first vertex; the intersection is the
+// signed sum of the pairwise intersections of those triangles, each clipped as convex polygons. Triangle
+// pairs with disjoint bounding boxes are skipped.
+double PolygonOverlapArea(const std::vector<gp_XY>& a, const std::vector<gp_XY>& b);
@@ -0,0 +1,10 @@
+#include "pair_pipeline.h"
+
+template HaunchResult FindHaunchesWith<VertexPipeline>(const std::shared_ptr<const FaceIndex>&, const HaunchParams&);
+template HaunchResult FindHaunchesWith<OverlapPipeline>(const std::shared_ptr<const FaceIndex>&, const HaunchParams&);
+template HaunchResult FindHaunchesWith<VertexAreaPipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                           const HaunchParams&);
+template HaunchResult FindHaunchesWith<OverlapAreaPipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                            const HaunchParams&);
+template HaunchResult FindHaunchesWith<ReferencePipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                          const HaunchParams&);
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "haunch.h"
+
+#include <gp.hxx>
+#include <gp_Ax2.hxx>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <thread>
+
+// Two planar faces tested as a haunch pair by a PairPipeline. Predicates fill in what they measure, so
+// later stages and the reported pair reuse it instead of measuring again.
+struct PairCandidate
+{
+  const FaceIndex* index; // null for an index without a shape, then only precomputed areas are known
+  const FaceFeature& face1;
+  const FaceFeature& face2;
+  double distance = 0.0; // offset along the normal of face1, set by OffsetRange
+  double area1    = -1.0; // set by AreaRatio, negative when not measured
+  double area2    = -1.0;
+};
+
+// Predicate policies. Each is a stateless type with a static test(); they only read the tolerances they
+// are about from the params, so any of them can be left out of a pipeline.
+
+struct ParallelNormals
+{
+  static bool test(PairCandidate& candidate, const HaunchParams& params)
+  {
+    return candidate.face1.normal.IsParallel(candidate.face2.normal, params.angular_tol);
+  }
+};
+
+struct OffsetRange
+{
+  static bool test(PairCandidate& candidate, const HaunchParams& params)
+  {
+    candidate.distance =
+        std::abs(gp_Vec(candidate.face1.centroid, candidate.face2.centroid).Dot(gp_Vec(candidate.face1.normal)));
+    return candidate.distance <= params.max_distance;
+  }
+};
+
+// Boxes of both faces in the plane of face1 must overlap within lateral_tol. Matching vertices and
+// overlapping outlines both imply it, so this only rejects early: one pass over the points instead of the
+// quadratic vertex comparison or the polygon clipping. Outlines are used when the overlap matcher is on,
+// since curved edges may bulge past the vertices.
+struct BoxOverlap
+{
+  static bool test(PairCandidate& candidate, const HaunchParams& params)
+  {
+    const gp_Ax2 plane(gp::Origin(), candidate.face1.normal);
+    const gp_XYZ x = plane.XDirection().XYZ();
+    const gp_XYZ y = plane.YDirection().XYZ();
+    const bool outlines =
+        params.min_overlap > 0.0 && !candidate.face1.outline.empty() && !candidate.face2.outline.empty();
+
+    double lo1[2], hi1[2], lo2[2], hi2[2];
+    box(outlines ? candidate.face1.outline : candidate.face1.vertices, x, y, lo1, hi1);
+    box(outlines ? candidate.face2.outline : candidate.face2.vertices, x, y, lo2, hi2);
+    const double slack = params.lateral_tol;
+    return lo1[0] <= hi2[0] + slack && lo2[0] <= hi1[0] + slack && lo1[1] <= hi2[1] + slack
+           && lo2[1] <= hi1[1] + slack;
+  }
+
+  static void box(const std::vector<gp_Pnt>& points, const gp_XYZ& x, const gp_XYZ& y, double lo[2], double hi[2])
+  {
+    lo[0] = lo[1] = RealLast();
+    hi[0] = hi[1] = RealFirst();
+    for (const gp_Pnt& point : points)
+    {
+      const double u = x.Dot(point.XYZ());
+      const double v = y.Dot(point.XYZ());
+      lo[0]          = std::min(lo[0], u);
+      hi[0]          = std::max(hi[0], u);
+      lo[1]          = std::min(lo[1], v);
+      hi[1]          = std::max(hi[1], v);
+    }
+  }
+};
+
+struct VertexMatch
+{
+  static bool test(PairCandidate& candidate, const HaunchParams& params)
+  {
+    return HaveSameVertices(
+        candidate.face1, candidate.face2, candidate.distance, params.lateral_tol, params.offset_tol);
+  }
+};
+
+struct OutlineMatch
+{
+  static bool test(PairCandidate& candidate, const HaunchParams& params)
+  {
+    return candidate.distance > Precision::Confusion()
+           && OutlineOverlap(candidate.face1, candidate.face2) >= params.min_overlap;
+  }
+};
+
+// Smaller area over larger area at least min_area_ratio. Areas are the costliest measure, keep it last.
+struct AreaRatio
+{
+  static bool test(PairCandidate& candidate, const HaunchParams& params)
+  {
+    if (params.min_area_ratio <= 0.0)
+      return true;
+    candidate.area1 = area(candidate.index, candidate.face1);
+    candidate.area2 = area(candidate.index, candidate.face2);
+    if (candidate.area1 < 0.0 || candidate.area2 < 0.0)
+      return true;
+    const double larger = std::max(candidate.area1, candidate.area2);
+    return larger <= 0.0 || std::min(candidate.area1, candidate.area2) >= params.min_area_ratio * larger;
+  }
+
+  static double area(const FaceIndex* index, const FaceFeature& feature)
+  {
+    if (feature.area >= 0.0 || index == nullptr || index->faces().IsEmpty())
+      return feature.area;
+    return FaceArea(index->face(feature.id));
+  }
+};
+
+// The hard-wired matcher the pipelines replaced (MatchFeatures), kept as the reference of --check-pipeline.
+struct ReferenceMatch
+{
+  static bool test(PairCandidate& candidate, const HaunchParams& params)
+  {
+    return MatchFeatures(candidate.face1, candidate.face2, params, candidate.distance);
+  }
+};
+
+// Chain of predicate policies run in order, stopping at the first that fails.
+//
+// Every stage is resolved at compile time, so the whole chain inlines into the pair search of the
+// pipeline instead of branching on params for every candidate. A custom check is a type with a static
+// test(PairCandidate&, const HaunchParams&), appended to the chain and run with FindHaunchesWith.
+template <class... Predicates>
+struct PairPipeline
+{
+  static bool match(PairCandidate& candidate, const HaunchParams& params)
+  {
+    return (Predicates::test(candidate, params) && ...);
+  }
+};
+
+// Configurations FindHaunches picks from HaunchParams. Their pair searches are instantiated once, in
+// pair_pipeline.cpp; searches with other pipelines are instantiated where they are used.
+using VertexPipeline      = PairPipeline<ParallelNormals, OffsetRange, BoxOverlap, VertexMatch>;
+using OverlapPipeline     = PairPipeline<ParallelNormals, OffsetRange, BoxOverlap, OutlineMatch>;
+using VertexAreaPipeline  = PairPipeline<ParallelNormals, OffsetRange, BoxOverlap, VertexMatch, AreaRatio>;
+using OverlapAreaPipeline = PairPipeline<ParallelNormals, OffsetRange, BoxOverlap, OutlineMatch, AreaRatio>;
+using ReferencePipeline   = PairPipeline<ReferenceMatch, AreaRatio>;
+
+// Call visit with a default constructed value of the configuration matching params.
+template <class Visitor>
+decltype(auto) VisitPipeline(const HaunchParams& params, Visitor&& visit)
+{
+  if (params.min_area_ratio > 0.0)
+  {
+    if (params.min_overlap > 0.0) { return visit(OverlapAreaPipeline()); }
+    return visit(VertexAreaPipeline());
+  }
+  if (params.min_overlap > 0.0) { return visit(OverlapPipeline()); }
+  return visit(VertexPipeline());
+}
+
+// Full check of one candidate pair, appending it to pairs when it matches.
+template <class Pipeline>
+void MatchPairWith(const FaceIndex& index,
+                   int feature1,
+                   int feature2,
+                   const HaunchParams& params,
+                   std::vector<HaunchPair>& pairs)
+{
+  const FaceFeature& face1 = index.features()[feature1];
+  const FaceFeature& face2 = index.features()[feature2];
+  PairCandidate candidate { &index, face1, face2 };
+  if (!Pipeline::match(candidate, params))
+    return;
+
+  const double area1 = candidate.area1 >= 0.0 ? candidate.area1 : AreaRatio::area(&index, face1);
+  const double area2 = candidate.area2 >= 0.0 ? candidate.area2 : AreaRatio::area(&index, face2);
+  if (face1.id < face2.id) { pairs.push_back({ face1.id, face2.id, candidate.distance, face1.normal, area1, area2 }); }
+  else { pairs.push_back({ face2.id, face1.id, candidate.distance, face1.normal, area2, area1 }); }
+}
+
+// Pair search of FindHaunches with the given pipeline.
+//
+// Features are handed out to the threads in blocks; every thread collects its own pairs and the
+// merged list is sorted, so the output does not depend on the thread count or on scheduling.
+template <class Pipeline>
+HaunchResult FindHaunchesWith(const std::shared_ptr<const FaceIndex>& index, const HaunchParams& params)
+{
+  static constexpr int BLOCK = 64;
+
+  HaunchResult result;
+  result.shape      = index->shape();
+  result.index      = index;
+  result.face_count = index->face_count();
+
+  const int feature_count = static_cast<int>(index->features().size());
+  const int requested     = params.threads > 0 ? params.threads : static_cast<int>(std::thread::hardware_concurrency());
+  const int thread_count  = std::clamp(requested, 1, std::max(1, feature_count / BLOCK));
+
+  std::vector<std::vector<HaunchPair>> found(thread_count);
+  std::vector<std::exception_ptr> errors(thread_count);
+  std::atomic<int> next { 0 };
+  // An exception escaping a worker thread would terminate the process, e.g. a Standard_Failure from the area
+  // computation. It is kept instead, the other workers stop at their next block, and it is rethrown here.
+  const auto search = [&](int worker) {
+    try
+    {
+      std::vector<int> candidates;
+      for (int begin = next.fetch_add(BLOCK); begin < feature_count; begin = next.fetch_add(BLOCK))
+      {
+        for (int i = begin; i < std::min(begin + BLOCK, feature_count); ++i)
+        {
+          candidates.clear();
+          index->partners(i, params.max_distance, candidates);
+          for (int j : candidates)
+          {
+            // every pair is reported by both faces, keep one
+            if (j > i) { MatchPairWith<Pipeline>(*index, i, j, params, found[worker]); }
+          }
+        }
+      }
+    }
+    catch (...)
+    {
+      errors[worker] = std::current_exception();
+      next           = feature_count;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < thread_count; ++t) { threads.emplace_back(search, t); }
+  search(0);
+  for (std::thread& thread : threads) { thread.join(); }
+  for (const std::exception_ptr& error : errors)
+  {
+    if (error) { std::rethrow_exception(error); }
+  }
+
+  for (std::vector<HaunchPair>& pairs : found) { result.pairs.insert(result.pairs.end(), pairs.begin(), pairs.end()); }
+  SortHaunchPairs(result.pairs);
+  return result;
+}
+
+extern template HaunchResult FindHaunchesWith<VertexPipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                              const HaunchParams&);
+extern template HaunchResult FindHaunchesWith<OverlapPipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                               const HaunchParams&);
+extern template HaunchResult FindHaunchesWith<VertexAreaPipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                                  const HaunchParams&);
+extern template HaunchResult FindHaunchesWith<OverlapAreaPipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                                   const HaunchParams&);
+extern template HaunchResult FindHaunchesWith<ReferencePipeline>(const std::shared_ptr<const FaceIndex>&,
+                                                                 const HaunchParams&);
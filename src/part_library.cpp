@@ -0,0 +1,266 @@
+#include "part_library.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <queue>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  static constexpr char LIBRARY_MAGIC[4]    = { 'R', 'D', 'L', 'B' };
+  static constexpr uint32_t LIBRARY_VERSION = 1;
+
+  struct LibraryHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint32_t dims;
+    uint32_t count;
+    uint64_t name_bytes; // NUL terminated names follow the signatures, in part order
+  };
+
+  static constexpr double MIN_THICKNESS = 0.25;
+
+  // Scale a count or an area of up to `range` to about [0, 1].
+  float logScale(double value, double range)
+  {
+    return static_cast<float>(std::log1p(std::max(0.0, value)) / std::log1p(range));
+  }
+
+  int normalBin(const gp_Dir& normal)
+  {
+    const double c[3] = { normal.X(), normal.Y(), normal.Z() };
+    int axis          = 0;
+    for (int i = 1; i < 3; ++i)
+    {
+      if (std::abs(c[i]) > std::abs(c[axis])) { axis = i; }
+    }
+    // Opposite normals describe the same plane
+    const double sign = c[axis] < 0.0 ? -1.0 : 1.0;
+    const double u    = sign * c[(axis + 1) % 3] / std::abs(c[axis]);
+    const double v    = sign * c[(axis + 2) % 3] / std::abs(c[axis]);
+    const auto cell   = [](double t) { return std::clamp(static_cast<int>((t + 1.0) * 2.0), 0, 3); };
+    return axis * 16 + cell(u) * 4 + cell(v);
+  }
+
+  int thicknessBin(double thickness)
+  {
+    if (thickness <= MIN_THICKNESS) { return 0; }
+    return std::min(PartSignature::THICKNESS_BINS - 1, static_cast<int>(std::log2(thickness / MIN_THICKNESS)));
+  }
+
+  float squaredDistance(const float* a, const float* b)
+  {
+    static_assert(PartSignature::DIMS % 8 == 0, "signatures are processed in blocks of 8 floats");
+#if defined(__AVX__)
+    __m256 sum = _mm256_setzero_ps();
+    for (int i = 0; i < PartSignature::DIMS; i += 8)
+    {
+      const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+      sum            = _mm256_add_ps(sum, _mm256_mul_ps(d, d));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 half = _mm_setzero_ps();
+    for (int i = 0; i < PartSignature::DIMS; i += 4)
+    {
+      const __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+      half           = _mm_add_ps(half, _mm_mul_ps(d, d));
+    }
+#endif
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < PartSignature::DIMS; ++i)
+    {
+      const float d = a[i] - b[i];
+      sum += d * d;
+    }
+    return sum;
+#endif
+  }
+
+  // Results are taken by reference from a vector or from a single result
+  template <class Results>
+  PartSignature computeSignature(const Results& results)
+  {
+    PartSignature signature;
+    float* normals   = signature.values.data();
+    float* thickness = normals + PartSignature::NORMAL_BINS;
+    float* scalars   = thickness + PartSignature::THICKNESS_BINS;
+
+    double total = 0.0;
+    size_t ribs = 0, pairs = 0, faces = 0;
+    for (const HaunchResult& result : results)
+    {
+      for (const HaunchPair& pair : result.pairs)
+      {
+        // Pairs without measured areas still count, with the weight of a unit face
+        const double weight = std::max(0.5 * (pair.area1 + pair.area2), 1.0);
+        normals[normalBin(pair.normal)] += static_cast<float>(weight);
+        thickness[thicknessBin(pair.thickness)] += static_cast<float>(weight);
+        total += weight;
+      }
+      ribs += result.features.size();
+      pairs += result.pairs.size();
+      faces += static_cast<size_t>(std::max(0, result.face_count));
+    }
+
+    if (total > 0.0)
+    {
+      for (int i = 0; i < PartSignature::NORMAL_BINS + PartSignature::THICKNESS_BINS; ++i)
+      {
+        signature.values[i] = static_cast<float>(signature.values[i] / total);
+      }
+    }
+    scalars[0] = logScale(static_cast<double>(ribs), 1e3);
+    scalars[1] = logScale(static_cast<double>(pairs), 1e4);
+    scalars[2] = logScale(static_cast<double>(faces), 1e6);
+    scalars[3] = logScale(total, 1e8);
+    return signature;
+  }
+} // namespace
+
+PartSignature ComputePartSignature(const std::vector<HaunchResult>& results)
+{
+  return computeSignature(results);
+}
+
+PartSignature ComputePartSignature(const HaunchResult& result)
+{
+  return computeSignature(std::array<std::reference_wrapper<const HaunchResult>, 1> { result });
+}
+
+bool PartLibrary::load(const std::string& path)
+{
+  clear();
+
+  std::ifstream in(path, std::ios::binary);
+  if (!in) { return true; }
+
+  LibraryHeader header {};
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+      || std::memcmp(header.magic, LIBRARY_MAGIC, sizeof(LIBRARY_MAGIC)) != 0 || header.version != LIBRARY_VERSION
+      || header.dims != PartSignature::DIMS)
+  {
+    return false;
+  }
+
+  // The payload has to fill the rest of the file exactly, so a corrupt header never sizes the buffers
+  std::error_code error;
+  const uint64_t file_bytes      = std::filesystem::file_size(path, error);
+  const uint64_t signature_bytes = uint64_t(header.count) * PartSignature::DIMS * sizeof(float);
+  if (error || file_bytes < sizeof(header) + signature_bytes
+      || header.name_bytes != file_bytes - sizeof(header) - signature_bytes)
+  {
+    return false;
+  }
+
+  std::vector<float> signatures(size_t(header.count) * PartSignature::DIMS);
+  std::string names(header.name_bytes, '\0');
+  if (!in.read(reinterpret_cast<char*>(signatures.data()), std::streamsize(signatures.size() * sizeof(float)))
+      || !in.read(names.data(), std::streamsize(names.size())))
+  {
+    return false;
+  }
+
+  m_signatures.swap(signatures);
+  for (size_t begin = 0; begin < names.size() && m_names.size() < header.count;)
+  {
+    const size_t end = names.find('\0', begin);
+    m_position_of[names.substr(begin, end - begin)] = m_names.size();
+    m_names.push_back(names.substr(begin, end - begin));
+    begin = end == std::string::npos ? names.size() : end + 1;
+  }
+  if (m_names.size() != header.count)
+  {
+    clear();
+    return false;
+  }
+  return true;
+}
+
+bool PartLibrary::save(const std::string& path) const
+{
+  std::string names;
+  for (const std::string& name : m_names)
+  {
+    names += name;
+    names += '\0';
+  }
+
+  LibraryHeader header {};
+  std::memcpy(header.magic, LIBRARY_MAGIC, sizeof(LIBRARY_MAGIC));
+  header.version    = LIBRARY_VERSION;
+  header.dims       = PartSignature::DIMS;
+  header.count      = static_cast<uint32_t>(m_names.size());
+  header.name_bytes = names.size();
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) { return false; }
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(m_signatures.data()), std::streamsize(m_signatures.size() * sizeof(float)));
+  out.write(names.data(), std::streamsize(names.size()));
+  return static_cast<bool>(out);
+}
+
+void PartLibrary::clear()
+{
+  m_signatures.clear();
+  m_names.clear();
+  m_position_of.clear();
+}
+
+void PartLibrary::add(const std::string& name, const PartSignature& signature)
+{
+  const auto [it, inserted] = m_position_of.emplace(name, m_names.size());
+  if (inserted)
+  {
+    m_names.push_back(name);
+    m_signatures.insert(m_signatures.end(), signature.values.begin(), signature.values.end());
+    return;
+  }
+  std::copy(signature.values.begin(), signature.values.end(), m_signatures.begin() + it->second * PartSignature::DIMS);
+}
+
+std::vector<SimilarPart> PartLibrary::nearest(const PartSignature& query, size_t k) const
+{
+  Profiler::Scope timer("similar parts");
+  k = std::min(k, m_names.size());
+  if (k == 0) { return {}; }
+
+  // Max-heap of the k best so far, its top is the one to replace
+  std::priority_queue<std::pair<float, size_t>> best;
+  const float* signature = m_signatures.data();
+  for (size_t i = 0; i < m_names.size(); ++i, signature += PartSignature::DIMS)
+  {
+    const float distance = squaredDistance(query.values.data(), signature);
+    if (best.size() < k) { best.emplace(distance, i); }
+    else if (distance < best.top().first)
+    {
+      best.pop();
+      best.emplace(distance, i);
+    }
+  }
+
+  std::vector<SimilarPart> similar(best.size());
+  for (size_t i = similar.size(); i-- > 0; best.pop())
+  {
+    similar[i] = { m_names[best.top().second], std::sqrt(best.top().first) };
+  }
+  return similar;
+}
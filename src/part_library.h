@@ -0,0 +1,65 @@
+#pragma once
+
+#include "haunch.h"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compact description of the rib layout of a part, compared by Euclidean distance.
+//
+//   [0, 48)   normals of the haunch pairs, weighted by face area: dominant axis times a 4x4 grid of the
+//             other two components, as on the faces of a cube
+//   [48, 60)  pair thickness, weighted by face area, in octaves from 0.25 to 1024 model units
+//   [60, 64)  rib count, pair count, face count and paired area, each log scaled to about [0, 1]
+//
+// Both histograms sum to 1 when there is any pair, so the layout counts as much as the scalars.
+struct PartSignature
+{
+  static constexpr int NORMAL_BINS    = 48;
+  static constexpr int THICKNESS_BINS = 12;
+  static constexpr int SCALARS        = 4;
+  static constexpr int DIMS           = NORMAL_BINS + THICKNESS_BINS + SCALARS;
+
+  std::array<float, DIMS> values {};
+};
+
+// Signature of a part made of the shapes of several results, e.g. the roots of one STEP file.
+PartSignature ComputePartSignature(const std::vector<HaunchResult>& results);
+PartSignature ComputePartSignature(const HaunchResult& result);
+
+struct SimilarPart
+{
+  std::string name;
+  float distance;
+};
+
+// Local on-disk index of part signatures, keyed by name (the model path in batch runs).
+//
+// Signatures are packed into one contiguous float array, so a query is a single pass computing squared
+// distances with SIMD (AVX or SSE2 where the compiler targets them, plain loops otherwise) while keeping
+// the k best in a heap; at 256 bytes per part 100k parts are scanned in a few milliseconds. The file
+// (.rdl) is the header, the packed signatures and the names, and is rewritten completely by save().
+class PartLibrary
+{
+ public:
+  // An empty library when the file does not exist yet; false when it exists but cannot be read, or its size
+  // does not match the part count and name bytes of its header.
+  bool load(const std::string& path);
+  bool save(const std::string& path) const;
+
+  // Add a part, replacing the signature of a part with the same name.
+  void add(const std::string& name, const PartSignature& signature);
+  void clear();
+
+  size_t size() const { return m_names.size(); }
+
+  // The k parts closest to the query, nearest first.
+  std::vector<SimilarPart> nearest(const PartSignature& query, size_t k) const;
+
+ private:
+  std::vector<float> m_signatures; // PartSignature::DIMS per part
+  std::vector<std::string> m_names;
+  std::unordered_map<std::string, size_t> m_position_of;
+};
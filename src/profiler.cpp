@@ -0,0 +1,35 @@
+#include "profiler.h"
+
+#include <algorithm>
+
+Profiler& Profiler::instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+void Profiler::record(const std::string& name, double value, const char* unit)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& e) { return e.name == name; });
+  if (it == m_entries.end())
+  {
+    m_entries.push_back({ name, unit });
+    it = m_entries.end() - 1;
+  }
+  it->last = value;
+  it->total += value;
+  ++it->count;
+}
+
+std::vector<Profiler::Entry> Profiler::snapshot() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries;
+}
+
+void Profiler::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Process wide collection of named measurements shown in the profiler section of the Gui panel.
+// Measurements may be recorded from any thread.
+class Profiler
+{
+ public:
+  struct Entry
+  {
+    std::string name;
+    std::string unit;
+    double last  = 0.0;
+    double total = 0.0;
+    int count    = 0;
+
+    double average() const { return count == 0 ? 0.0 : total / count; }
+  };
+
+  // Measures the lifetime of the object and records it in milliseconds.
+  class Scope
+  {
+   public:
+    explicit Scope(std::string name) : m_name(std::move(name)), m_start(std::chrono::steady_clock::now()) {}
+    ~Scope() { Profiler::instance().record(m_name, elapsed_ms()); }
+
+    double elapsed_ms() const
+    {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+   private:
+    std::string m_name;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  static Profiler& instance();
+
+  void record(const std::string& name, double value, const char* unit = "ms");
+  std::vector<Entry> snapshot() const;
+  void clear();
+
+ private:
+  mutable std::mutex m_mutex;
+  std::vector<Entry> m_entries;
+};
@@ -0,0 +1,226 @@
+#include "rib_features.h"
+#include "profiler.h"
+
+#include <TopExp_Explorer.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <gp_Ax2.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+  // Union-find with union by size and path halving.
+  class DisjointSets
+  {
+   public:
+    explicit DisjointSets(size_t count) : m_parent(count), m_size(count, 1)
+    {
+      std::iota(m_parent.begin(), m_parent.end(), 0);
+    }
+
+    int find(int x)
+    {
+      while (m_parent[x] != x)
+      {
+        m_parent[x] = m_parent[m_parent[x]];
+        x           = m_parent[x];
+      }
+      return x;
+    }
+
+    void unite(int a, int b)
+    {
+      a = find(a);
+      b = find(b);
+      if (a == b)
+        return;
+      if (m_size[a] < m_size[b]) { std::swap(a, b); }
+      m_parent[b] = a;
+      m_size[a] += m_size[b];
+    }
+
+   private:
+    std::vector<int> m_parent;
+    std::vector<int> m_size;
+  };
+
+  bool coplanar(const FaceFeature& a, const FaceFeature& b, const HaunchParams& params)
+  {
+    if (a.normal.Angle(b.normal) > std::max(params.angular_tol, Precision::Angular()))
+      return false;
+    const double offset = gp_Vec(a.normal).Dot(gp_Vec(a.centroid, b.centroid));
+    return std::abs(offset) <= std::max(params.offset_tol, Precision::Confusion());
+  }
+
+  // Extents of the side vertices in the plane of the sides, along and across their principal axis.
+  void measureSides(const std::vector<gp_Pnt>& points, RibFeature& feature)
+  {
+    if (points.empty())
+      return;
+
+    const gp_Ax2 frame(points.front(), feature.normal);
+    const gp_XYZ x = frame.XDirection().XYZ();
+    const gp_XYZ y = frame.YDirection().XYZ();
+    std::vector<gp_XY> flat;
+    flat.reserve(points.size());
+    gp_XY mean(0.0, 0.0);
+    for (const gp_Pnt& point : points)
+    {
+      feature.box.Add(point);
+      flat.emplace_back(x.Dot(point.XYZ()), y.Dot(point.XYZ()));
+      mean += flat.back();
+    }
+    mean /= static_cast<double>(flat.size());
+
+    double cxx = 0.0, cyy = 0.0, cxy = 0.0;
+    for (const gp_XY& p : flat)
+    {
+      const gp_XY d = p - mean;
+      cxx += d.X() * d.X();
+      cyy += d.Y() * d.Y();
+      cxy += d.X() * d.Y();
+    }
+    const double angle = 0.5 * std::atan2(2.0 * cxy, cxx - cyy);
+    const gp_XY along(std::cos(angle), std::sin(angle));
+    const gp_XY across(-along.Y(), along.X());
+
+    double min_along = RealLast(), max_along = RealFirst(), min_across = RealLast(), max_across = RealFirst();
+    for (const gp_XY& p : flat)
+    {
+      min_along  = std::min(min_along, p * along);
+      max_along  = std::max(max_along, p * along);
+      min_across = std::min(min_across, p * across);
+      max_across = std::max(max_across, p * across);
+    }
+    feature.length = max_along - min_along;
+    feature.height = max_across - min_across;
+    if (feature.length < feature.height) { std::swap(feature.length, feature.height); }
+  }
+} // namespace
+
+void GroupRibFeatures(HaunchResult& result, const HaunchParams& params)
+{
+  Profiler::Scope timer("rib features");
+  result.features.clear();
+  std::shared_ptr<const FaceIndex> index = result.index;
+  if ((!index || index->faces().IsEmpty()) && !result.shape.IsNull())
+  {
+    index = std::make_shared<const FaceIndex>(result.shape);
+  }
+  const bool has_geometry = index && !index->faces().IsEmpty();
+
+  // Nodes of the union-find are the faces taking part in a pair
+  int face_count = result.face_count;
+  for (const HaunchPair& pair : result.pairs) { face_count = std::max({ face_count, pair.face1, pair.face2 }); }
+  std::vector<int> node_of(face_count + 1, -1);
+  int nodes = 0;
+  for (const HaunchPair& pair : result.pairs)
+  {
+    if (node_of[pair.face1] < 0) { node_of[pair.face1] = nodes++; }
+    if (node_of[pair.face2] < 0) { node_of[pair.face2] = nodes++; }
+  }
+
+  DisjointSets sets(nodes);
+  for (const HaunchPair& pair : result.pairs) { sets.unite(node_of[pair.face1], node_of[pair.face2]); }
+
+  if (has_geometry)
+  {
+    // A side split along the rib shows up as coplanar paired faces sharing an edge. Only the edges of paired
+    // faces are walked, so a local query on a large model does not map the edges of the whole shape.
+    TopTools_IndexedMapOfShape edges;
+    std::vector<std::vector<int>> edge_faces;
+    for (int face = 1; face <= std::min(face_count, index->face_count()); ++face)
+    {
+      if (node_of[face] < 0 || index->feature_of(face) < 0)
+        continue;
+      for (TopExp_Explorer it(index->face(face), TopAbs_EDGE); it.More(); it.Next())
+      {
+        const int edge = edges.Add(it.Current());
+        if (edge > static_cast<int>(edge_faces.size())) { edge_faces.emplace_back(); }
+        std::vector<int>& faces = edge_faces[edge - 1];
+        if (faces.empty() || faces.back() != face) { faces.push_back(face); }
+      }
+    }
+    for (const std::vector<int>& paired : edge_faces)
+    {
+      for (size_t i = 0; i < paired.size(); ++i)
+      {
+        for (size_t j = i + 1; j < paired.size(); ++j)
+        {
+          const FaceFeature& a = index->features()[index->feature_of(paired[i])];
+          const FaceFeature& b = index->features()[index->feature_of(paired[j])];
+          if (coplanar(a, b, params)) { sets.unite(node_of[paired[i]], node_of[paired[j]]); }
+        }
+      }
+    }
+  }
+
+  // Pairs are sorted, so numbering the sets by their first pair does not depend on the union order
+  std::vector<int> feature_of_root(nodes, -1);
+  for (HaunchPair& pair : result.pairs)
+  {
+    int& feature = feature_of_root[sets.find(node_of[pair.face1])];
+    if (feature < 0)
+    {
+      feature = static_cast<int>(result.features.size());
+      result.features.emplace_back();
+      result.features.back().normal = pair.normal;
+    }
+    pair.feature = feature;
+  }
+  LinkRibFeatures(result);
+
+  std::vector<gp_Pnt> points;
+  for (RibFeature& feature : result.features)
+  {
+    double weighted = 0.0, weights = 0.0, sum = 0.0;
+    for (const int p : feature.pairs)
+    {
+      const HaunchPair& pair = result.pairs[p];
+      const double weight    = std::max(0.0, 0.5 * (pair.area1 + pair.area2));
+      weighted += weight * pair.thickness;
+      weights += weight;
+      sum += pair.thickness;
+    }
+    feature.thickness = weights > 0.0 ? weighted / weights : sum / static_cast<double>(feature.pairs.size());
+
+    if (!has_geometry)
+      continue;
+    points.clear();
+    for (const int face : feature.faces)
+    {
+      const int f = index->feature_of(face);
+      if (f < 0)
+        continue;
+      const std::vector<gp_Pnt>& vertices = index->features()[f].vertices;
+      points.insert(points.end(), vertices.begin(), vertices.end());
+    }
+    measureSides(points, feature);
+  }
+}
+
+void LinkRibFeatures(HaunchResult& result)
+{
+  for (RibFeature& feature : result.features)
+  {
+    feature.pairs.clear();
+    feature.faces.clear();
+  }
+  for (size_t p = 0; p < result.pairs.size(); ++p)
+  {
+    const HaunchPair& pair = result.pairs[p];
+    if (pair.feature < 0 || pair.feature >= static_cast<int>(result.features.size()))
+      continue;
+    RibFeature& feature = result.features[pair.feature];
+    feature.pairs.push_back(static_cast<int>(p));
+    feature.faces.push_back(pair.face1);
+    feature.faces.push_back(pair.face2);
+  }
+  for (RibFeature& feature : result.features)
+  {
+    std::sort(feature.faces.begin(), feature.faces.end());
+    feature.faces.erase(std::unique(feature.faces.begin(), feature.faces.end()), feature.faces.end());
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "haunch.h"
+
+// Merge the pairs of a result into rib features and fill result.features and the feature of every pair.
+//
+// Two pairs belong to the same rib when they share a face, or when a face of one and a face of the other
+// are coplanar within the tolerances of params and share an edge, as the pieces of a side split along
+// the rib do. Pairs are joined by a union-find over face ids in a single batch, so grouping stays linear
+// in the number of pairs and of edges of their faces, whatever the size of the model. Features are ordered
+// by their first pair.
+//
+// The geometry comes from result.index, or from result.shape when the index has none. Without either,
+// as after streaming detection, only shared faces join pairs and length, height and box stay empty.
+void GroupRibFeatures(HaunchResult& result, const HaunchParams& params);
+
+// Rebuild the pairs and faces lists of result.features from the feature of every pair, after the
+// features were transferred without them.
+void LinkRibFeatures(HaunchResult& result);
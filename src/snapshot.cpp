@@ -0,0 +1,161 @@
+#include "snapshot.h"
+#include "profiler.h"
+
+#include <AIS_ColoredShape.hxx>
+#include <Aspect_DisplayConnection.hxx>
+#include <Image_AlienPixMap.hxx>
+#include <OpenGl_GraphicDriver.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <V3d_Viewer.hxx>
+
+#ifdef _WIN32
+#include <WNT_WClass.hxx>
+#include <WNT_Window.hxx>
+#elif defined(__APPLE__)
+#include <Cocoa_Window.hxx>
+#else
+#include <Xw_Window.hxx>
+#endif
+
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+  struct Preset
+  {
+    SnapshotView view;
+    const char* name;
+    V3d_TypeOfOrientation orientation;
+  };
+
+  static constexpr Preset PRESETS[] = {
+    { SnapshotView::Iso, "iso", V3d_XposYnegZpos },
+    { SnapshotView::Front, "front", V3d_Yneg },
+    { SnapshotView::Top, "top", V3d_Zpos },
+    { SnapshotView::Right, "right", V3d_Xpos },
+  };
+
+  const Preset& preset(SnapshotView view)
+  {
+    for (const Preset& p : PRESETS)
+    {
+      if (p.view == view) { return p; }
+    }
+    return PRESETS[0];
+  }
+} // namespace
+
+const char* SnapshotViewName(SnapshotView view) { return preset(view).name; }
+
+bool ParseSnapshotViews(const std::string& list, std::vector<SnapshotView>& views)
+{
+  views.clear();
+  std::istringstream in(list);
+  for (std::string name; std::getline(in, name, ',');)
+  {
+    if (name.empty())
+      continue;
+    bool known = false;
+    for (const Preset& p : PRESETS)
+    {
+      if (name == p.name)
+      {
+        views.push_back(p.view);
+        known = true;
+      }
+    }
+    if (!known) { return false; }
+  }
+  return !views.empty();
+}
+
+bool SnapshotRenderer::init()
+{
+  if (!m_view.IsNull()) { return true; }
+  if (m_failed) { return false; }
+  m_failed = true;
+
+  try
+  {
+    Handle(Aspect_DisplayConnection) disp = new Aspect_DisplayConnection();
+    Handle(OpenGl_GraphicDriver) driver   = new OpenGl_GraphicDriver(disp, true);
+    driver->ChangeOptions().ffpEnable     = false;
+    driver->ChangeOptions().swapInterval  = 0;
+
+    Handle(V3d_Viewer) viewer = new V3d_Viewer(driver);
+    viewer->SetDefaultLights();
+    viewer->SetLightOn();
+    m_context = new AIS_InteractiveContext(viewer);
+
+    const TCollection_AsciiString name("RD snapshot");
+#if defined(_WIN32)
+    Handle(WNT_WClass) win_class = new WNT_WClass("SnapshotClass", nullptr, 0);
+    Handle(WNT_Window) window =
+        new WNT_Window(name.ToCString(), win_class, WS_POPUP, 64, 64, m_size, m_size, Quantity_NOC_BLACK);
+#elif defined(__APPLE__)
+    Handle(Cocoa_Window) window = new Cocoa_Window(name.ToCString(), 64, 64, m_size, m_size);
+#else
+    Handle(Xw_Window) window = new Xw_Window(disp, name.ToCString(), 64, 64, m_size, m_size);
+#endif
+    window->SetVirtual(true);
+
+    m_view = viewer->CreateView();
+    m_view->SetWindow(window);
+    m_view->SetBackgroundColor(Quantity_NOC_WHITE);
+    m_view->SetImmediateUpdate(false);
+  }
+  catch (const Standard_Failure& error)
+  {
+    std::cerr << "Cannot create the snapshot viewer: " << error.GetMessageString() << "\n";
+    m_context.Nullify();
+    m_view.Nullify();
+    return false;
+  }
+  m_failed = false;
+  return true;
+}
+
+bool SnapshotRenderer::render(const HaunchResult& result,
+                              const std::vector<SnapshotView>& views,
+                              const std::string& prefix)
+{
+  if (result.shape.IsNull() || !init()) { return false; }
+  Profiler::Scope timer("snapshot");
+
+  // Face ids of the pairs number the faces of the shape as TopExp::MapShapes does
+  TopTools_IndexedMapOfShape mapped;
+  const TopTools_IndexedMapOfShape* faces = &mapped;
+  if (result.index && !result.index->faces().IsEmpty()) { faces = &result.index->faces(); }
+  else { TopExp::MapShapes(result.shape, TopAbs_FACE, mapped); }
+
+  Handle(AIS_ColoredShape) object = new AIS_ColoredShape(result.shape);
+  object->SetColor(Quantity_NOC_GRAY70);
+  for (const HaunchPair& pair : result.pairs)
+  {
+    for (int id : { pair.face1, pair.face2 })
+    {
+      if (id >= 1 && id <= faces->Extent()) { object->SetCustomColor(faces->FindKey(id), Quantity_NOC_RED); }
+    }
+  }
+  m_context->Display(object, AIS_Shaded, -1, false);
+
+  bool ok = true;
+  Image_AlienPixMap image;
+  for (const SnapshotView view : views)
+  {
+    const std::string path = prefix + "_" + SnapshotViewName(view) + ".png";
+    m_view->SetProj(preset(view).orientation, false);
+    m_view->FitAll(0.05, false);
+    if (!m_view->ToPixMap(image, m_size, m_size) || !image.Save(TCollection_AsciiString(path.c_str())))
+    {
+      std::cerr << "Failed to write snapshot " << path << "\n";
+      ok = false;
+    }
+  }
+
+  // The viewer is kept for the next file, only its content goes
+  m_context->Remove(object, false);
+  return ok;
+}
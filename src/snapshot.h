@@ -0,0 +1,51 @@
+#pragma once
+
+#include "haunch.h"
+
+#include <AIS_InteractiveContext.hxx>
+#include <V3d_View.hxx>
+
+#include <string>
+#include <vector>
+
+// Fixed camera presets of the batch snapshots.
+enum class SnapshotView
+{
+  Iso,
+  Front,
+  Top,
+  Right
+};
+
+const char* SnapshotViewName(SnapshotView view);
+
+// Comma separated preset names, e.g. "iso,top". Returns false on an unknown name.
+bool ParseSnapshotViews(const std::string& list, std::vector<SnapshotView>& views);
+
+// Offscreen renderer of result snapshots: the shape shaded, with the faces of detected haunches in red.
+//
+// The graphic driver, viewer and view on a virtual window are created on the first snapshot and reused for
+// every later one, so a batch pays for the OpenGL context once. A display connection is still needed:
+// without a desktop run under Xvfb (xvfb-run), with Mesa's software OpenGL when there is no GPU. Each
+// batch worker process owns its renderer, so snapshots are rendered on as many contexts as there are jobs
+// and keep pace with detection. PNG files are written by Image_AlienPixMap, which needs OCCT built with
+// FreeImage.
+class SnapshotRenderer
+{
+ public:
+  explicit SnapshotRenderer(int size = 512) : m_size(size) {}
+
+  SnapshotRenderer(const SnapshotRenderer&)            = delete;
+  SnapshotRenderer& operator=(const SnapshotRenderer&) = delete;
+
+  // Render result.shape from every preset into <prefix>_<view>.png.
+  bool render(const HaunchResult& result, const std::vector<SnapshotView>& views, const std::string& prefix);
+
+ private:
+  bool init();
+
+  int m_size;
+  bool m_failed = false; // the viewer could not be created, later snapshots fail right away
+  Handle(AIS_InteractiveContext) m_context;
+  Handle(V3d_View) m_view;
+};
@@ -0,0 +1,434 @@
+#include "stream_detect.h"
+#include "pair_pipeline.h"
+#include "profiler.h"
+
+#include <TopExp.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Iterator.hxx>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+  // Coarse normal cell used for partitioning, per component of the unit normal.
+  static constexpr double PARTITION_CELL = 0.1;
+  // Every face is also copied into the cells around its normal, so that each partner FaceIndex::partners()
+  // can reach is present in the partition the search runs in.
+  static constexpr double PARTITION_HALO = 3.0 * FaceIndex::NORMAL_CELL;
+  static constexpr int OFFSET_BINS       = 256;
+  static constexpr uint32_t HOME_FLAG    = 1;
+
+  struct RecordHeader
+  {
+    uint32_t id;
+    uint32_t vertex_count;
+    uint32_t flags;
+    uint32_t reserved;
+    double normal[3];
+    double centroid[3];
+    double area;
+  };
+
+  size_t recordSize(const FaceFeature& feature)
+  {
+    return sizeof(RecordHeader) + feature.vertices.size() * 3 * sizeof(double);
+  }
+
+  void writeRecord(std::FILE* file, const FaceFeature& feature, uint32_t flags)
+  {
+    RecordHeader header {};
+    header.id           = static_cast<uint32_t>(feature.id);
+    header.vertex_count = static_cast<uint32_t>(feature.vertices.size());
+    header.flags        = flags;
+    header.normal[0]    = feature.normal.X();
+    header.normal[1]    = feature.normal.Y();
+    header.normal[2]    = feature.normal.Z();
+    header.centroid[0]  = feature.centroid.X();
+    header.centroid[1]  = feature.centroid.Y();
+    header.centroid[2]  = feature.centroid.Z();
+    header.area         = feature.area;
+    std::fwrite(&header, sizeof(header), 1, file);
+    for (const gp_Pnt& vertex : feature.vertices)
+    {
+      const double xyz[3] = { vertex.X(), vertex.Y(), vertex.Z() };
+      std::fwrite(xyz, sizeof(xyz), 1, file);
+    }
+  }
+
+  bool readRecord(std::FILE* file, FaceFeature& feature, uint32_t& flags)
+  {
+    RecordHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1)
+      return false;
+
+    feature.id       = static_cast<int>(header.id);
+    feature.normal   = gp_Dir(header.normal[0], header.normal[1], header.normal[2]);
+    feature.centroid = gp_Pnt(header.centroid[0], header.centroid[1], header.centroid[2]);
+    feature.area     = header.area;
+    feature.vertices.resize(header.vertex_count);
+    for (gp_Pnt& vertex : feature.vertices)
+    {
+      double xyz[3];
+      if (std::fread(xyz, sizeof(xyz), 1, file) != 1)
+        return false;
+      vertex.SetCoord(xyz[0], xyz[1], xyz[2]);
+    }
+    flags = header.flags;
+    return true;
+  }
+
+  // Temporary file removed when the object goes away.
+  class SpillFile
+  {
+   public:
+    explicit SpillFile(std::filesystem::path path) :
+        m_path(std::move(path)), m_file(std::fopen(m_path.string().c_str(), "w+b"))
+    {
+      if (m_file == nullptr) { throw std::runtime_error("Cannot create spill file " + m_path.string()); }
+    }
+
+    ~SpillFile()
+    {
+      std::fclose(m_file);
+      std::error_code error;
+      std::filesystem::remove(m_path, error);
+    }
+
+    SpillFile(const SpillFile&)            = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    std::FILE* get() const { return m_file; }
+    void rewind() const { std::rewind(m_file); }
+
+   private:
+    std::filesystem::path m_path;
+    std::FILE* m_file;
+  };
+
+  using CellKey = uint64_t;
+
+  int64_t coarse(double value) { return static_cast<int64_t>(std::floor(value / PARTITION_CELL)); }
+
+  CellKey cellKey(int64_t x, int64_t y, int64_t z)
+  {
+    const int64_t bias = int64_t(1) << 20;
+    return (uint64_t(x + bias) << 42) | (uint64_t(y + bias) << 21) | uint64_t(z + bias);
+  }
+
+  CellKey homeCell(const gp_Dir& normal)
+  {
+    return cellKey(coarse(normal.X()), coarse(normal.Y()), coarse(normal.Z()));
+  }
+
+  // Unit vector through the middle of the cell; offsets inside a cell are measured along it.
+  gp_XYZ cellAxis(CellKey key)
+  {
+    const int64_t bias = int64_t(1) << 20;
+    const int64_t mask = (int64_t(1) << 21) - 1;
+    const gp_XYZ center((((int64_t(key >> 42) & mask) - bias) + 0.5) * PARTITION_CELL,
+                        (((int64_t(key >> 21) & mask) - bias) + 0.5) * PARTITION_CELL,
+                        (((int64_t(key) & mask) - bias) + 0.5) * PARTITION_CELL);
+    return center / center.Modulus();
+  }
+
+  void cellsOf(const gp_Dir& normal, std::vector<CellKey>& cells)
+  {
+    cells.clear();
+    const auto addBox = [&](const gp_XYZ& n) {
+      for (int64_t x = coarse(n.X() - PARTITION_HALO); x <= coarse(n.X() + PARTITION_HALO); ++x)
+        for (int64_t y = coarse(n.Y() - PARTITION_HALO); y <= coarse(n.Y() + PARTITION_HALO); ++y)
+          for (int64_t z = coarse(n.Z() - PARTITION_HALO); z <= coarse(n.Z() + PARTITION_HALO); ++z)
+            cells.push_back(cellKey(x, y, z));
+    };
+    addBox(normal.XYZ());
+
+    // Near a tie of the two largest components a partner may have been canonicalised to the opposite sign
+    std::array<double, 3> magnitudes = { std::abs(normal.X()), std::abs(normal.Y()), std::abs(normal.Z()) };
+    std::sort(magnitudes.begin(), magnitudes.end(), std::greater<double>());
+    if (magnitudes[0] - magnitudes[1] <= 2.0 * PARTITION_HALO) { addBox(-normal.XYZ()); }
+
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+  }
+
+  // Offset histogram of one normal cell and the slabs it is cut into.
+  struct CellPlan
+  {
+    gp_XYZ axis;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    std::vector<size_t> bins;
+    std::vector<double> cuts;     // upper offset bound of every slab but the last
+    std::vector<int> partitions; // partition of every slab
+
+    int bin(double offset) const
+    {
+      if (max <= min)
+        return 0;
+      const int b = static_cast<int>((offset - min) / (max - min) * OFFSET_BINS);
+      return std::clamp(b, 0, OFFSET_BINS - 1);
+    }
+
+    double binStart(int b) const { return min + (max - min) * b / OFFSET_BINS; }
+
+    int slab(double offset) const
+    {
+      return static_cast<int>(std::upper_bound(cuts.begin(), cuts.end(), offset) - cuts.begin());
+    }
+  };
+
+  // Cut every cell into offset slabs and pack consecutive slabs into partitions of at most `target` bytes.
+  //
+  // A slab receives every record within `reach` of it, not only those whose offset falls inside, so it is
+  // sized by the bins it covers widened by reach on both sides. A slab is at least one bin, which may hold
+  // more than the target on its own; the number of such slabs is returned in `oversized`.
+  int planPartitions(std::map<CellKey, CellPlan>& plans, size_t target, double reach, size_t& oversized)
+  {
+    int partition          = -1;
+    size_t partition_bytes = 0;
+    const auto closeSlab   = [&](CellPlan& plan, size_t bytes) {
+      if (partition < 0 || partition_bytes + bytes > target)
+      {
+        ++partition;
+        partition_bytes = 0;
+      }
+      partition_bytes += bytes;
+      plan.partitions.push_back(partition);
+      if (bytes > target) { ++oversized; }
+    };
+
+    oversized = 0;
+    for (auto& [key, plan] : plans)
+    {
+      std::vector<size_t> prefix(OFFSET_BINS + 1, 0);
+      for (int b = 0; b < OFFSET_BINS; ++b) { prefix[b + 1] = prefix[b] + plan.bins[b]; }
+
+      // Bins within reach of a bin, on either side
+      const double width = (plan.max - plan.min) / OFFSET_BINS;
+      const int halo     = width > 0.0 ? static_cast<int>(std::min<double>(std::ceil(reach / width), OFFSET_BINS))
+                                       : OFFSET_BINS;
+      const auto slabBytes = [&](int first, int last) {
+        return prefix[std::min(last + halo, OFFSET_BINS)] - prefix[std::max(first - halo, 0)];
+      };
+
+      int first = 0;
+      for (int b = 1; b < OFFSET_BINS; ++b)
+      {
+        if (slabBytes(first, b + 1) > target)
+        {
+          plan.cuts.push_back(plan.binStart(b));
+          closeSlab(plan, slabBytes(first, b));
+          first = b;
+        }
+      }
+      closeSlab(plan, slabBytes(first, OFFSET_BINS));
+    }
+    return partition + 1;
+  }
+} // namespace
+
+HaunchResult FindHaunchesStreaming(TopoDS_Shape& shape, const StreamOptions& options)
+{
+  if (options.params.min_overlap > 0.0)
+  {
+    throw std::invalid_argument("The overlap matcher is not available in streaming detection");
+  }
+
+  namespace fs       = std::filesystem;
+  const fs::path dir = options.spill_dir.empty() ? fs::temp_directory_path() : fs::path(options.spill_dir);
+  const std::string prefix = "rd_stream_" + std::to_string(std::random_device {}());
+
+  HaunchResult result;
+  std::map<CellKey, CellPlan> plans;
+  std::vector<CellKey> cells;
+
+  // 1. Summarise planar faces one sub-shape at a time, in the order TopExp::MapShapes would visit them
+  SpillFile features(dir / (prefix + "_features.bin"));
+  {
+    Profiler::Scope timer("stream summarize");
+    std::vector<TopoDS_Shape> pending;
+    pending.push_back(shape);
+    shape.Nullify();
+
+    FaceFeature feature;
+    while (!pending.empty())
+    {
+      TopoDS_Shape current = pending.back();
+      pending.pop_back();
+      if (current.ShapeType() == TopAbs_COMPOUND)
+      {
+        std::vector<TopoDS_Shape> children;
+        for (TopoDS_Iterator it(current); it.More(); it.Next()) { children.push_back(it.Value()); }
+        pending.insert(pending.end(), children.rbegin(), children.rend());
+        continue;
+      }
+
+      TopTools_IndexedMapOfShape faces;
+      TopExp::MapShapes(current, TopAbs_FACE, faces);
+      for (int i = 1; i <= faces.Extent(); ++i)
+      {
+        const int id = ++result.face_count;
+        if (!MakeFaceFeature(TopoDS::Face(faces(i)), id, feature))
+          continue;
+        feature.area = FaceArea(TopoDS::Face(faces(i)));
+        writeRecord(features.get(), feature, 0);
+
+        cellsOf(feature.normal, cells);
+        for (CellKey key : cells)
+        {
+          CellPlan& plan      = plans[key];
+          plan.axis           = cellAxis(key);
+          const double offset = plan.axis.Dot(feature.centroid.XYZ());
+          plan.min            = std::min(plan.min, offset);
+          plan.max            = std::max(plan.max, offset);
+        }
+      }
+      // `current` goes out of scope here, releasing the sub-shape's topology
+    }
+  }
+
+  // Partners share their vertices up to the lateral tolerance, so their centroids differ by little more than
+  // the distance along the normal whatever the cell axis
+  const double reach = options.params.max_distance + options.params.lateral_tol + Precision::Confusion();
+
+  // 2. Offset histograms, then partitions small enough for the memory budget, counting the records copied in
+  // from neighbouring slabs. Feature records take roughly a third of the in-memory footprint once loaded and
+  // indexed.
+  int partition_count = 0;
+  size_t oversized    = 0;
+  {
+    Profiler::Scope timer("stream partition");
+    for (auto& [key, plan] : plans) { plan.bins.assign(OFFSET_BINS, 0); }
+
+    FaceFeature feature;
+    uint32_t flags = 0;
+    features.rewind();
+    while (readRecord(features.get(), feature, flags))
+    {
+      cellsOf(feature.normal, cells);
+      for (CellKey key : cells)
+      {
+        CellPlan& plan = plans[key];
+        plan.bins[plan.bin(plan.axis.Dot(feature.centroid.XYZ()))] += recordSize(feature);
+      }
+    }
+    partition_count = planPartitions(plans, std::max<size_t>(options.memory_budget / 3, 1), reach, oversized);
+  }
+  Profiler::instance().record("stream partitions", partition_count, "");
+  if (oversized > 0)
+  {
+    std::cerr << "Warning: " << oversized << " offset slabs of " << partition_count
+              << " partitions cannot be split below the memory budget of " << (options.memory_budget >> 10)
+              << " KB; the pair search will hold more\n";
+  }
+
+  // 3. Copy every record into the partitions its partners can live in, marking the one that owns it
+  std::vector<std::unique_ptr<SpillFile>> partitions(partition_count);
+  {
+    Profiler::Scope timer("stream distribute");
+    FaceFeature feature;
+    uint32_t flags = 0;
+    std::vector<int> targets;
+    features.rewind();
+    while (readRecord(features.get(), feature, flags))
+    {
+      const CellPlan& home_plan = plans.at(homeCell(feature.normal));
+      const int home = home_plan.partitions[home_plan.slab(home_plan.axis.Dot(feature.centroid.XYZ()))];
+
+      targets.clear();
+      cellsOf(feature.normal, cells);
+      for (CellKey key : cells)
+      {
+        const CellPlan& plan = plans.at(key);
+        const double offset  = plan.axis.Dot(feature.centroid.XYZ());
+        for (int slab = plan.slab(offset - reach); slab <= plan.slab(offset + reach); ++slab)
+        {
+          targets.push_back(plan.partitions[slab]);
+        }
+      }
+      std::sort(targets.begin(), targets.end());
+      targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+      for (int target : targets)
+      {
+        if (!partitions[target])
+        {
+          const std::string name = prefix + "_part" + std::to_string(target) + ".bin";
+          partitions[target]     = std::make_unique<SpillFile>(dir / name);
+        }
+        writeRecord(partitions[target]->get(), feature, target == home ? HOME_FLAG : 0);
+      }
+    }
+  }
+
+  // 4. Pair search per partition. A pair is reported by the partition owning its face with the lower id.
+  {
+    Profiler::Scope timer("stream search");
+    std::vector<int> candidates;
+    for (std::unique_ptr<SpillFile>& partition : partitions)
+    {
+      if (!partition)
+        continue;
+
+      std::vector<FaceFeature> local;
+      std::vector<int> global_ids;
+      std::vector<char> owned;
+      std::unordered_map<int, int> local_of;
+
+      FaceFeature feature;
+      uint32_t flags = 0;
+      partition->rewind();
+      while (readRecord(partition->get(), feature, flags))
+      {
+        auto [it, inserted] = local_of.emplace(feature.id, static_cast<int>(local.size()));
+        if (inserted)
+        {
+          global_ids.push_back(feature.id);
+          owned.push_back(0);
+          feature.id = static_cast<int>(local.size()) + 1;
+          local.push_back(feature);
+        }
+        owned[it->second] |= (flags & HOME_FLAG) != 0 ? 1 : 0;
+      }
+
+      const FaceIndex index(std::move(local), static_cast<int>(global_ids.size()));
+      const auto& indexed = index.features();
+      VisitPipeline(options.params, [&](auto pipeline) {
+        for (int i = 0; i < static_cast<int>(indexed.size()); ++i)
+        {
+          if (!owned[i])
+            continue;
+
+          candidates.clear();
+          index.partners(i, options.params.max_distance, candidates);
+          for (int j : candidates)
+          {
+            PairCandidate candidate { &index, indexed[i], indexed[j] };
+            if (global_ids[j] < global_ids[i] || !decltype(pipeline)::match(candidate, options.params))
+              continue;
+            result.pairs.push_back({ global_ids[i],
+                                     global_ids[j],
+                                     candidate.distance,
+                                     indexed[i].normal,
+                                     indexed[i].area,
+                                     indexed[j].area });
+          }
+        }
+      });
+      partition.reset();
+    }
+  }
+
+  SortHaunchPairs(result.pairs);
+  return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "haunch.h"
+
+#include <cstddef>
+#include <string>
+
+struct StreamOptions
+{
+  HaunchParams params;
+  size_t memory_budget = size_t(256) << 20; // bytes of face features held in memory during the pair search
+  std::string spill_dir;                    // empty for the system temporary directory
+};
+
+// Bounded memory variant of FindHaunches for very large models.
+//
+// The shape is walked one non-compound sub-shape at a time; every planar face is summarised into an on-disk
+// feature file and each sub-shape is released once summarised. The features are then split into partitions
+// by normal direction and plane offset so that no partition exceeds the memory budget, and the usual
+// bucketed pair search runs on one partition at a time. The caller's shape handle is released.
+//
+// The budget covers the pair search only: the caller still holds the shape until it is handed over, and a
+// partition is never cut finer than one of the 256 offset bins of its normal cell, so a bin whose records,
+// with those within reach of it, exceed the budget is searched anyway after a warning on stderr.
+//
+// Face ids match TopExp::MapShapes as long as different sub-shapes do not share faces. The result carries
+// no shape or index, only the face count and the pairs sorted by face ids. Spill records carry no outlines,
+// so only the vertex matcher is supported (params.min_overlap must be 0).
+HaunchResult FindHaunchesStreaming(TopoDS_Shape& shape, const StreamOptions& options);
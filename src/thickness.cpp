@@ -0,0 +1,151 @@
+#include "thickness.h"
+#include "haunch.h"
+
+#include <gp_Ax2.hxx>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+namespace
+{
+  struct Extent
+  {
+    double u_min = std::numeric_limits<double>::max();
+    double u_max = std::numeric_limits<double>::lowest();
+    double v_min = std::numeric_limits<double>::max();
+    double v_max = std::numeric_limits<double>::lowest();
+  };
+
+  Extent inPlaneExtent(const FaceFeature& feature, const gp_Ax2& axes)
+  {
+    const gp_XYZ u = axes.XDirection().XYZ();
+    const gp_XYZ v = axes.YDirection().XYZ();
+    Extent extent;
+    for (const gp_Pnt& vertex : feature.vertices)
+    {
+      extent.u_min = std::min(extent.u_min, u.Dot(vertex.XYZ()));
+      extent.u_max = std::max(extent.u_max, u.Dot(vertex.XYZ()));
+      extent.v_min = std::min(extent.v_min, v.Dot(vertex.XYZ()));
+      extent.v_max = std::max(extent.v_max, v.Dot(vertex.XYZ()));
+    }
+    return extent;
+  }
+
+  bool overlaps(const Extent& a, const Extent& b)
+  {
+    const double tol = Precision::Confusion();
+    return a.u_min < b.u_max - tol && b.u_min < a.u_max - tol && a.v_min < b.v_max - tol && b.v_min < a.v_max - tol;
+  }
+} // namespace
+
+ThicknessMap ComputeThicknessMap(const std::shared_ptr<const FaceIndex>& index,
+                                 double max_distance,
+                                 double angular_tol)
+{
+  ThicknessMap map;
+  map.index = index;
+
+  // Outward normals: the index only keeps the unsigned direction of every plane
+  const auto& features = index->features();
+  std::vector<gp_Dir> outward(features.size());
+  for (size_t i = 0; i < features.size(); ++i)
+  {
+    const TopoDS_Face& face = index->face(features[i].id);
+    GetFacePlaneNormal(face, outward[i]);
+    if (face.Orientation() == TopAbs_REVERSED) { outward[i].Reverse(); }
+  }
+
+  std::vector<int> candidates;
+  for (int i = 0; i < static_cast<int>(features.size()); ++i)
+  {
+    const FaceFeature& face = features[i];
+    const gp_Ax2 axes(face.centroid, face.normal);
+    const Extent extent = inPlaneExtent(face, axes);
+
+    double best  = std::numeric_limits<double>::max();
+    int opposite = -1;
+    candidates.clear();
+    index->partners(i, max_distance, candidates);
+    for (int j : candidates)
+    {
+      if (!face.normal.IsParallel(features[j].normal, angular_tol) || outward[i].Dot(outward[j]) >= 0.0)
+        continue;
+
+      // The opposite side of a wall lies behind the face
+      const double depth = -gp_Vec(face.centroid, features[j].centroid).Dot(gp_Vec(outward[i]));
+      if (depth <= Precision::Confusion() || depth > max_distance || depth >= best)
+        continue;
+      if (!overlaps(extent, inPlaneExtent(features[j], axes)))
+        continue;
+
+      best     = depth;
+      opposite = j;
+    }
+
+    if (opposite < 0)
+      continue;
+    map.faces.push_back({ face.id, features[opposite].id, best });
+    map.min = map.faces.size() == 1 ? best : std::min(map.min, best);
+    map.max = std::max(map.max, best);
+  }
+
+  return map;
+}
+
+std::vector<float> ThicknessHistogram(const std::vector<ThicknessMap>& maps, double lo, double hi, int bins)
+{
+  std::vector<float> counts(std::max(bins, 1), 0.0f);
+  const double width = hi > lo ? (hi - lo) / counts.size() : 1.0;
+  for (const ThicknessMap& map : maps)
+  {
+    for (const FaceThickness& face : map.faces)
+    {
+      const int bin = static_cast<int>((face.thickness - lo) / width);
+      counts[std::clamp(bin, 0, static_cast<int>(counts.size()) - 1)] += 1.0f;
+    }
+  }
+  return counts;
+}
+
+Quantity_Color ThicknessColor(double t)
+{
+  return Quantity_Color(240.0 * std::clamp(t, 0.0, 1.0), 0.5, 1.0, Quantity_TOC_HLS);
+}
+
+// Same sub-shape coloring as HighlightHaunches: one presentation rebuild of the parent object.
+void ShowThicknessMap(const Handle(AIS_InteractiveContext)& context,
+                      const ThicknessMap& map,
+                      double lo,
+                      double hi,
+                      bool on)
+{
+  Handle(AIS_ColoredShape) colored = Handle(AIS_ColoredShape)::DownCast(map.object);
+  if (colored.IsNull() || map.faces.empty())
+    return;
+
+  const double range = hi > lo ? hi - lo : 1.0;
+  for (const FaceThickness& face : map.faces)
+  {
+    if (on) { colored->SetCustomColor(map.index->face(face.face), ThicknessColor((face.thickness - lo) / range)); }
+    else { colored->UnsetCustomAspects(map.index->face(face.face), true); }
+  }
+  context->Redisplay(colored, Standard_False);
+}
+
+bool WriteThicknessCsv(const char* path, const std::vector<ThicknessMap>& maps)
+{
+  FILE* out = std::fopen(path, "w");
+  if (out == nullptr)
+    return false;
+
+  std::fprintf(out, "shape,face,opposite,thickness\n");
+  for (size_t s = 0; s < maps.size(); ++s)
+  {
+    for (const FaceThickness& face : maps[s].faces)
+    {
+      std::fprintf(out, "%zu,%d,%d,%.9g\n", s, face.face, face.opposite, face.thickness);
+    }
+  }
+  return std::fclose(out) == 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "face_index.h"
+
+#include <AIS_InteractiveContext.hxx>
+#include <Quantity_Color.hxx>
+
+#include <memory>
+#include <vector>
+
+// Wall thickness at one planar face: distance to the nearest parallel face behind it that faces the other
+// way and overlaps it in the plane.
+struct FaceThickness
+{
+  int face;
+  int opposite;
+  double thickness;
+};
+
+// Thickness of every planar face of a shape that has an opposing face within the search distance.
+// object is the displayed presentation the map was computed for, null without a viewer.
+struct ThicknessMap
+{
+  std::shared_ptr<const FaceIndex> index;
+  Handle(AIS_InteractiveObject) object;
+  std::vector<FaceThickness> faces; // sorted by face id
+  double min = 0.0;
+  double max = 0.0;
+};
+
+// Uses the offset index, so every face only looks at the candidates FaceIndex::partners() returns.
+ThicknessMap ComputeThicknessMap(const std::shared_ptr<const FaceIndex>& index,
+                                 double max_distance,
+                                 double angular_tol);
+
+// Face counts per thickness over [lo, hi] split into `bins` bins, as ImGui::PlotHistogram expects them.
+std::vector<float> ThicknessHistogram(const std::vector<ThicknessMap>& maps, double lo, double hi, int bins);
+
+// Color ramp of the map for t in [0, 1]: red for thin walls through green to blue for thick ones.
+Quantity_Color ThicknessColor(double t);
+
+// Color the faces of the map's object by thickness between lo and hi, or remove the colors again.
+void ShowThicknessMap(const Handle(AIS_InteractiveContext)& context,
+                      const ThicknessMap& map,
+                      double lo,
+                      double hi,
+                      bool on);
+
+// One line per face: shape index, face id, opposite face id and thickness.
+bool WriteThicknessCsv(const char* path, const std::vector<ThicknessMap>& maps);
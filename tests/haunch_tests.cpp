@@ -0,0 +1,257 @@
+// Edge cases of the haunch detector on shapes built in code, run by ctest without a display:
+//
+//   rd_tests [<case>...]
+//
+// Without arguments every case runs. Each case builds its faces with BRepPrimAPI or from polygons, runs the
+// detector and compares the pair count with the one it has to report. The exit code fails when any differs.
+
+#include "haunch.h"
+#include "thickness.h"
+
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRep_Builder.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS_Compound.hxx>
+#include <gp.hxx>
+#include <gp_Ax1.hxx>
+#include <gp_Ax3.hxx>
+#include <gp_Pln.hxx>
+#include <gp_Trsf.hxx>
+
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  static constexpr double SIZE = 10.0;
+  static constexpr double GAP  = 2.0;
+
+  struct Case
+  {
+    const char* name;
+    std::function<bool()> run;
+  };
+
+  // Planar face bounded by the closed polygon through `points`; its normal follows the point order.
+  TopoDS_Face polygonFace(std::initializer_list<gp_Pnt> points)
+  {
+    BRepBuilderAPI_MakePolygon polygon;
+    for (const gp_Pnt& point : points) { polygon.Add(point); }
+    polygon.Close();
+    return BRepBuilderAPI_MakeFace(polygon.Wire(), Standard_True).Face();
+  }
+
+  // SIZE x SIZE square at height z, shifted along x; counter-clockwise seen from +Z unless `flipped`.
+  TopoDS_Face square(double z, double shift = 0.0, bool flipped = false)
+  {
+    const gp_Pnt a(shift, 0.0, z), b(shift + SIZE, 0.0, z), c(shift + SIZE, SIZE, z), d(shift, SIZE, z);
+    return flipped ? polygonFace({ a, d, c, b }) : polygonFace({ a, b, c, d });
+  }
+
+  TopoDS_Compound compound(std::initializer_list<TopoDS_Shape> shapes)
+  {
+    BRep_Builder builder;
+    TopoDS_Compound result;
+    builder.MakeCompound(result);
+    for (const TopoDS_Shape& shape : shapes) { builder.Add(result, shape); }
+    return result;
+  }
+
+  bool expectPairs(const std::string& what, const TopoDS_Shape& shape, const HaunchParams& params, size_t expected)
+  {
+    const size_t found = FindHaunches(shape, params).pairs.size();
+    if (found == expected)
+      return true;
+    std::cerr << what << ": expected " << expected << " haunch face pairs, found " << found << "\n";
+    return false;
+  }
+
+  // Planes with opposite normals are as parallel as planes with the same one.
+  bool oppositeNormals()
+  {
+    const HaunchParams params;
+    return expectPairs("same normals", compound({ square(0.0), square(GAP) }), params, 1)
+           && expectPairs("opposite normals", compound({ square(0.0), square(GAP, 0.0, true) }), params, 1);
+  }
+
+  // Instances of one box share their faces' TShapes; only the locations tell them apart. A box has its three
+  // pairs of opposite sides in every instance, including one rotated off the axes.
+  bool locatedFaces()
+  {
+    const TopoDS_Shape slab = BRepPrimAPI_MakeBox(SIZE, SIZE, GAP).Shape();
+
+    gp_Trsf moved, rotation, turned;
+    moved.SetTranslation(gp_Vec(100.0, 0.0, 0.0));
+    rotation.SetRotation(gp_Ax1(gp::Origin(), gp_Dir(1.0, 1.0, 1.0)), 0.5);
+    turned.SetTranslation(gp_Vec(0.0, 100.0, 0.0));
+    turned.Multiply(rotation);
+
+    const TopoDS_Shape shape =
+        compound({ slab, slab.Located(TopLoc_Location(moved)), slab.Located(TopLoc_Location(turned)) });
+    return expectPairs("located boxes", shape, HaunchParams(), 9);
+  }
+
+  // A side split by an extra vertex no longer matches vertex by vertex, but its outline still covers the
+  // opposite face.
+  bool vertexCounts()
+  {
+    const TopoDS_Face split = polygonFace({ gp_Pnt(0.0, 0.0, GAP),
+                                            gp_Pnt(0.5 * SIZE, 0.0, GAP),
+                                            gp_Pnt(SIZE, 0.0, GAP),
+                                            gp_Pnt(SIZE, SIZE, GAP),
+                                            gp_Pnt(0.0, SIZE, GAP) });
+    const TopoDS_Compound shape = compound({ square(0.0), split });
+
+    HaunchParams overlap;
+    overlap.min_overlap = 0.9;
+    return expectPairs("vertex matcher", shape, HaunchParams(), 0)
+           && expectPairs("overlap matcher", shape, overlap, 1);
+  }
+
+  bool lateralTolerance()
+  {
+    const HaunchParams params;
+    const double tol = params.lateral_tol;
+    return expectPairs("half the lateral tolerance", compound({ square(0.0), square(GAP, 0.5 * tol) }), params, 1)
+           && expectPairs("twice the lateral tolerance", compound({ square(0.0), square(GAP, 2.0 * tol) }), params, 0);
+  }
+
+  // The far side rises by `rise` across the face, so its vertices sit rise / 2 off the centroid distance.
+  bool offsetTolerance()
+  {
+    HaunchParams params;
+    params.angular_tol = FaceIndex::NORMAL_CELL;
+    const auto tilted  = [&](double rise) {
+      return compound({ square(0.0),
+                        polygonFace({ gp_Pnt(0.0, 0.0, GAP),
+                                      gp_Pnt(SIZE, 0.0, GAP),
+                                      gp_Pnt(SIZE, SIZE, GAP + rise),
+                                      gp_Pnt(0.0, SIZE, GAP + rise) }) });
+    };
+    return expectPairs("offsets inside the tolerance", tilted(1.6 * params.offset_tol), params, 1)
+           && expectPairs("offsets outside the tolerance", tilted(2.4 * params.offset_tol), params, 0);
+  }
+
+  bool maxDistance()
+  {
+    const HaunchParams params;
+    const double d = params.max_distance;
+    return expectPairs("just within max distance", compound({ square(0.0), square(d - 1e-3) }), params, 1)
+           && expectPairs("just beyond max distance", compound({ square(0.0), square(d + 1e-3) }), params, 0);
+  }
+
+  // Square of `size` at (x, y) rising by `slope` along x from height z.
+  TopoDS_Face slopedSquare(double x, double y, double z, double size, double slope)
+  {
+    return polygonFace({ gp_Pnt(x, y, z),
+                         gp_Pnt(x + size, y, z + slope * size),
+                         gp_Pnt(x + size, y + size, z + slope * size),
+                         gp_Pnt(x, y + size, z) });
+  }
+
+  // A small face in the far corner of a large one, nearly parallel to it and almost max_distance away. The
+  // normals fall into adjacent index cells, so the offsets of the small face are measured along a normal
+  // tilted from the large one, off by the tilt times the half diagonal between both centroids.
+  bool tiltedOverlap()
+  {
+    HaunchParams params;
+    params.min_overlap = 0.5;
+    params.angular_tol = FaceIndex::NORMAL_CELL;
+
+    const double size   = 1000.0;
+    const double corner = size - SIZE;
+    const TopoDS_Compound shape =
+        compound({ slopedSquare(0.0, 0.0, 0.0, size, 2e-4), slopedSquare(corner, corner, 20.1, SIZE, -5e-4) });
+    return expectPairs("tilted face in the corner", shape, params, 1);
+  }
+
+  // Rectangle on the plane through `origin` with normal `normal`, spanning width along `x` and depth along
+  // normal ^ x. Unlike polygonFace the plane normal, and so the outward side, is given.
+  TopoDS_Face rectangle(const gp_Pnt& origin, const gp_Dir& normal, const gp_Dir& x, double width, double depth)
+  {
+    return BRepBuilderAPI_MakeFace(gp_Pln(gp_Ax3(origin, normal, x)), 0.0, width, 0.0, depth).Face();
+  }
+
+  // A wall whose top side is split in two, the far half tilted just enough for its normal to fall into the
+  // next index cell. Its thickness is found from the centroid of the half, far from the bottom's centroid.
+  bool thicknessSplitFace()
+  {
+    const double length = 1000.0;
+    const double wall   = 2.9;
+    const double slope  = 8e-4;
+
+    const gp_Dir x(1.0, 0.0, 0.0);
+    const TopoDS_Face bottom = rectangle(gp_Pnt(0.0, SIZE, 0.0), gp_Dir(0.0, 0.0, -1.0), x, length, SIZE);
+    const TopoDS_Face near   = rectangle(gp_Pnt(0.0, 0.0, wall), gp_Dir(0.0, 0.0, 1.0), x, 0.5 * length, SIZE);
+    const TopoDS_Face far    = rectangle(gp_Pnt(0.5 * length, 0.0, wall),
+                                         gp_Dir(-slope, 0.0, 1.0),
+                                         gp_Dir(1.0, 0.0, slope),
+                                         0.5 * length * std::sqrt(1.0 + slope * slope),
+                                         SIZE);
+
+    const auto index       = std::make_shared<const FaceIndex>(compound({ bottom, near, far }));
+    const ThicknessMap map = ComputeThicknessMap(index, 3.0, FaceIndex::NORMAL_CELL);
+    for (const FaceThickness& face : map.faces)
+    {
+      if (face.face != index->faces().FindIndex(far))
+        continue;
+      if (face.opposite == index->faces().FindIndex(bottom) && std::abs(face.thickness - wall) < 1e-5)
+        return true;
+      std::cerr << "tilted half of a split wall: opposite face " << face.opposite << " at " << face.thickness << "\n";
+      return false;
+    }
+    std::cerr << "no opposite face found for the tilted half of a split wall\n";
+    return false;
+  }
+
+  const std::vector<Case>& cases()
+  {
+    static const std::vector<Case> all = {
+      { "opposite-normals", oppositeNormals },
+      { "located-faces", locatedFaces },
+      { "vertex-counts", vertexCounts },
+      { "lateral-tolerance", lateralTolerance },
+      { "offset-tolerance", offsetTolerance },
+      { "max-distance", maxDistance },
+      { "tilted-overlap", tiltedOverlap },
+      { "thickness-split-face", thicknessSplitFace },
+    };
+    return all;
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string> selected(argv + 1, argv + argc);
+  int failures = 0;
+  for (const std::string& name : selected)
+  {
+    bool known = false;
+    for (const Case& c : cases()) { known = known || name == c.name; }
+    if (!known)
+    {
+      std::cerr << "Unknown case: " << name << "\n";
+      ++failures;
+    }
+  }
+
+  for (const Case& c : cases())
+  {
+    bool wanted = selected.empty();
+    for (const std::string& name : selected) { wanted = wanted || name == c.name; }
+    if (!wanted)
+      continue;
+
+    const bool passed = c.run();
+    std::cout << c.name << ": " << (passed ? "passed" : "FAILED") << "\n";
+    if (!passed) { ++failures; }
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,179 @@
+// Generator of ribbed plates and rib grids with a known number of haunches, used as large inputs for
+// benchmarks and correctness checks:
+//
+//   rd_generate <out.brep> [--ribs <n>] [--grid] [--faces <n> | --tiles <n>]
+//
+// A tile is a plate with n ribs fused on top of it, or n ribs in each direction with --grid. Tiles are
+// repeated as located instances of the same topology until the face count is reached, so a model with a
+// million faces costs one boolean operation and stays small on disk.
+//
+// Next to the model, <out.brep>.truth lists its face count and the number of haunch pairs the detector has
+// to report for any max distance in [RIB_WIDTH, GAP), with the default tolerances.
+
+#include <BRepAlgoAPI_Fuse.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRepTools.hxx>
+#include <BRep_Builder.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <TopoDS_Compound.hxx>
+#include <gp_Trsf.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+  // Ribs are the only parallel faces closer than GAP: every other pair of parallel faces with matching
+  // vertices (plate ends, rib ends, neighbouring ribs, neighbouring tiles) is at least GAP apart.
+  static constexpr double RIB_WIDTH       = 4.0;
+  static constexpr double RIB_HEIGHT      = 10.0;
+  static constexpr double PLATE_THICKNESS = 5.0;
+  static constexpr double GAP             = 30.0;
+
+  struct Options
+  {
+    std::string output;
+    int ribs        = 4;
+    bool grid       = false;
+    long long faces = 0;
+    long long tiles = 1;
+  };
+
+  struct Tile
+  {
+    TopoDS_Shape shape;
+    double size_x   = 0.0;
+    double size_y   = 0.0;
+    int faces       = 0;
+    long long pairs = 0;
+  };
+
+  void printUsage()
+  {
+    std::cerr << "usage: rd_generate <out.brep> [--ribs <n>] [--grid] [--faces <n> | --tiles <n>]\n";
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+      const bool has_value  = i + 1 < argc;
+      if (arg == "--ribs" && has_value) { options.ribs = std::atoi(argv[++i]); }
+      else if (arg == "--grid") { options.grid = true; }
+      else if (arg == "--faces" && has_value) { options.faces = std::atoll(argv[++i]); }
+      else if (arg == "--tiles" && has_value) { options.tiles = std::atoll(argv[++i]); }
+      else if (!arg.empty() && arg[0] != '-' && options.output.empty()) { options.output = arg; }
+      else
+      {
+        std::cerr << "Unknown or incomplete option: " << arg << "\n";
+        return false;
+      }
+    }
+    // Without ribs the plate's top and bottom faces would pair up
+    return !options.output.empty() && options.ribs >= 1 && options.tiles >= 1;
+  }
+
+  // Length of a plate carrying `count` ribs side by side, GAP apart and GAP away from the border.
+  double plateLength(int count) { return GAP + count * (RIB_WIDTH + GAP); }
+
+  double ribStart(int index) { return GAP + index * (RIB_WIDTH + GAP); }
+
+  // Ribs run the whole plate length, so both of their side faces keep four vertices with identical
+  // coordinates across the rib. In a grid the crossing ribs cut every side into count + 1 such pieces.
+  bool makeTile(const Options& options, Tile& tile)
+  {
+    tile.size_x = plateLength(options.ribs);
+    tile.size_y = options.grid ? plateLength(options.ribs) : 2.0 * GAP;
+
+    TopTools_ListOfShape plate;
+    plate.Append(BRepPrimAPI_MakeBox(tile.size_x, tile.size_y, PLATE_THICKNESS).Shape());
+
+    TopTools_ListOfShape ribs;
+    for (int i = 0; i < options.ribs; ++i)
+    {
+      const gp_Pnt along_y(ribStart(i), 0.0, PLATE_THICKNESS);
+      ribs.Append(BRepPrimAPI_MakeBox(along_y, RIB_WIDTH, tile.size_y, RIB_HEIGHT).Shape());
+      if (options.grid)
+      {
+        const gp_Pnt along_x(0.0, ribStart(i), PLATE_THICKNESS);
+        ribs.Append(BRepPrimAPI_MakeBox(along_x, tile.size_x, RIB_WIDTH, RIB_HEIGHT).Shape());
+      }
+    }
+
+    BRepAlgoAPI_Fuse fuse;
+    fuse.SetArguments(plate);
+    fuse.SetTools(ribs);
+    fuse.Build();
+    if (!fuse.IsDone() || fuse.HasErrors())
+      return false;
+
+    tile.shape = fuse.Shape();
+    TopTools_IndexedMapOfShape faces;
+    TopExp::MapShapes(tile.shape, TopAbs_FACE, faces);
+    tile.faces = faces.Extent();
+    tile.pairs = options.grid ? 2LL * options.ribs * (options.ribs + 1) : options.ribs;
+    return true;
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  Tile tile;
+  if (!makeTile(options, tile))
+  {
+    std::cerr << "Boolean fusion of the ribs failed\n";
+    return EXIT_FAILURE;
+  }
+
+  const long long tiles = options.faces > 0 ? std::max(1LL, (options.faces + tile.faces - 1) / tile.faces)
+                                            : options.tiles;
+  const long long columns = static_cast<long long>(std::ceil(std::sqrt(static_cast<double>(tiles))));
+
+  // Instances share the tile's TShapes but their locations differ, so TopExp::MapShapes counts every face
+  BRep_Builder builder;
+  TopoDS_Compound compound;
+  builder.MakeCompound(compound);
+  for (long long t = 0; t < tiles; ++t)
+  {
+    gp_Trsf move;
+    move.SetTranslation(gp_Vec((t % columns) * (tile.size_x + GAP), (t / columns) * (tile.size_y + GAP), 0.0));
+    builder.Add(compound, tile.shape.Located(TopLoc_Location(move)));
+  }
+
+  if (!BRepTools::Write(compound, options.output.c_str()))
+  {
+    std::cerr << "Failed to write " << options.output << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const std::string truth_path = options.output + ".truth";
+  FILE* truth                  = std::fopen(truth_path.c_str(), "w");
+  if (truth == nullptr)
+  {
+    std::cerr << "Failed to write " << truth_path << "\n";
+    return EXIT_FAILURE;
+  }
+  std::fprintf(truth, "faces %lld\n", tiles * tile.faces);
+  std::fprintf(truth, "pairs %lld\n", tiles * tile.pairs);
+  std::fprintf(truth, "tiles %lld\n", tiles);
+  std::fprintf(truth, "max_distance_range %g %g\n", RIB_WIDTH, GAP);
+  std::fclose(truth);
+
+  std::cout << options.output << ": " << tiles << " tiles, " << tiles * tile.faces << " faces, "
+            << tiles * tile.pairs << " haunch pairs\n";
+  return EXIT_SUCCESS;
+}